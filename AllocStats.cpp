@@ -0,0 +1,319 @@
+#include "AllocStats.h"
+
+#ifdef SICXE_ALLOC_STATS
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <mutex>
+#include <new>
+#include <unistd.h>
+
+// Everything here is constant-initialized and never allocates through
+// operator new, so the hooks work before main and during static teardown.
+namespace {
+
+const int MAX_PHASES = 32;        // phase 0 is "(no phase)"
+const int STACK_DEPTH = 10;       // frames kept per allocation
+const int SITE_SLOTS = 16384;     // distinct (stack, phase) pairs
+const int TOP_SITES = 20;
+
+struct PhaseCount {
+    const char *name;
+    std::atomic<long> allocs, bytes;
+};
+
+struct Site {
+    uint64_t hash;                // 0 = empty slot
+    int phase;
+    int depth;
+    void *frames[STACK_DEPTH];
+    long allocs, bytes;
+};
+
+PhaseCount phases[MAX_PHASES];
+std::atomic<int> phaseCount{1};
+std::mutex phaseLock;
+
+Site sites[SITE_SLOTS];
+long overflowAllocs, overflowBytes;   // stacks that found no free slot
+std::mutex siteLock;
+
+std::atomic<long> totalAllocs{0}, totalBytes{0};
+thread_local int currentPhase = 0;
+thread_local bool inHook = false;     // backtrace() may re-enter on first use
+
+int phaseIndex(const char *name) {
+    std::lock_guard<std::mutex> g(phaseLock);
+    int n = phaseCount.load();
+    for (int i = 1; i < n; ++i)
+        if (phases[i].name == name || strcmp(phases[i].name, name) == 0) return i;
+    if (n == MAX_PHASES) return 0;
+    phases[n].name = name;
+    phaseCount.store(n + 1);
+    return n;
+}
+
+/********************************************************************
+*** FUNCTION record                                               ***
+*********************************************************************
+*** DESCRIPTION : Counts one allocation against the thread's phase***
+***               and against its (call stack, phase) slot.       ***
+***               Stacks are resolved to source functions only at ***
+***               exit, so this costs one backtrace and one probe.***
+*** INPUT ARGS  : size - bytes requested                          ***
+********************************************************************/
+void record(size_t size) {
+    totalAllocs.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add((long)size, std::memory_order_relaxed);
+    int phase = currentPhase;
+    phases[phase].allocs.fetch_add(1, std::memory_order_relaxed);
+    phases[phase].bytes.fetch_add((long)size, std::memory_order_relaxed);
+    if (inHook) return;
+
+    inHook = true;
+    void *frames[STACK_DEPTH];
+    int depth = backtrace(frames, STACK_DEPTH);
+    inHook = false;
+
+    uint64_t h = 1469598103934665603ull ^ (uint64_t)phase;   // FNV-1a over the frames
+    for (int i = 0; i < depth; ++i) {
+        h ^= (uint64_t)(uintptr_t)frames[i];
+        h *= 1099511628211ull;
+    }
+    if (h == 0) h = 1;
+
+    std::lock_guard<std::mutex> g(siteLock);
+    for (int probe = 0; probe < SITE_SLOTS; ++probe) {
+        Site &s = sites[(h + probe) & (SITE_SLOTS - 1)];
+        if (s.hash == 0) {
+            s.hash = h;
+            s.phase = phase;
+            s.depth = depth;
+            memcpy(s.frames, frames, sizeof(void*) * depth);
+        } else if (s.hash != h || s.phase != phase || s.depth != depth ||
+                   memcmp(s.frames, frames, sizeof(void*) * depth) != 0) {
+            continue;
+        }
+        ++s.allocs;
+        s.bytes += (long)size;
+        return;
+    }
+    ++overflowAllocs;
+    overflowBytes += (long)size;
+}
+
+// Frames 0 and 1 of every stack are record() and operator new
+const int FIRST_CALLER = 2;
+
+// Library code (std:: templates instantiated here) is skipped when looking
+// for the frame that asked for the memory
+bool isLibrarySymbol(const char *mangled) {
+    static const char *const PREFIXES[] = {
+        "_ZNSt", "_ZNKSt", "_ZSt", "_ZNSa", "_ZNKSa", "_ZN9__gnu_cxx", "_ZNK9__gnu_cxx",
+        "_ZNSi", "_ZNSo", "_ZNSd"
+    };
+    for (const char *p : PREFIXES)
+        if (strncmp(mangled, p, strlen(p)) == 0) return true;
+    return false;
+}
+
+// Offset of a return address's call instruction in this binary, or 0 if
+// it is in a shared library
+uintptr_t binaryOffset(void *frame) {
+    static Dl_info self;
+    if (!self.dli_fbase) dladdr((void*)&binaryOffset, &self);
+    Dl_info info;
+    void *pc = (char*)frame - 1;     // return addresses point after the call
+    if (!frame || !dladdr(pc, &info) || info.dli_fbase != self.dli_fbase) return 0;
+    return (uintptr_t)((char*)pc - (char*)info.dli_fbase);
+}
+
+struct Resolved {
+    uintptr_t offset;
+    char *function, *location;       // addr2line -f -C output lines
+};
+Resolved *resolved;
+size_t resolvedCount;
+
+int compareOffsets(const void *a, const void *b) {
+    uintptr_t x = ((const Resolved*)a)->offset, y = ((const Resolved*)b)->offset;
+    return x < y ? -1 : x > y;
+}
+
+/********************************************************************
+*** FUNCTION resolveFrames                                        ***
+*********************************************************************
+*** DESCRIPTION : Turns every recorded frame in this binary into  ***
+***               function and file:line with one addr2line run   ***
+***               (static functions and inlined std code are not  ***
+***               visible to dladdr). Leaves resolvedCount 0 if   ***
+***               addr2line is unavailable.                       ***
+********************************************************************/
+void resolveFrames() {
+    size_t cap = 0;
+    for (const Site &s : sites) cap += s.hash ? (size_t)s.depth : 0;
+    resolved = (Resolved*)calloc(cap ? cap : 1, sizeof(Resolved));
+    size_t n = 0;
+    for (const Site &s : sites)
+        for (int i = FIRST_CALLER; s.hash && i < s.depth; ++i)
+            if (uintptr_t off = binaryOffset(s.frames[i])) resolved[n++].offset = off;
+    qsort(resolved, n, sizeof(Resolved), compareOffsets);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (unique == 0 || resolved[unique - 1].offset != resolved[i].offset)
+            resolved[unique++].offset = resolved[i].offset;
+
+    char exe[4096], list[] = "/tmp/sicxe-alloc-XXXXXX";
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    int fd = mkstemp(list);
+    if (len <= 0 || fd < 0) return;
+    exe[len] = '\0';
+    FILE *addrs = fdopen(fd, "w");
+    for (size_t i = 0; i < unique; ++i) fprintf(addrs, "0x%lx\n", (unsigned long)resolved[i].offset);
+    fclose(addrs);
+
+    char cmd[8300];
+    snprintf(cmd, sizeof(cmd), "addr2line -f -C -e '%s' < %s 2>/dev/null", exe, list);
+    FILE *out = popen(cmd, "r");
+    size_t got = 0;
+    char line[4096];
+    while (out && got < unique && fgets(line, sizeof(line), out)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (!resolved[got].function) { resolved[got].function = strdup(line); continue; }
+        resolved[got++].location = strdup(line);
+    }
+    if (out) pclose(out);
+    unlink(list);
+    resolvedCount = got == unique ? unique : 0;
+}
+
+const Resolved *lookup(uintptr_t offset) {
+    Resolved key = {offset, nullptr, nullptr};
+    return (const Resolved*)bsearch(&key, resolved, resolvedCount, sizeof(Resolved), compareOffsets);
+}
+
+/********************************************************************
+*** FUNCTION describeSite                                         ***
+*********************************************************************
+*** DESCRIPTION : Names the first frame of a stack that is this   ***
+***               program's own code: "function (file:line)" from ***
+***               addr2line, skipping frames in system headers.   ***
+***               Without addr2line, the first non-std dynamic    ***
+***               symbol from dladdr, or binary+0xOFFSET.         ***
+*** INPUT ARGS  : s - recorded stack                              ***
+*** OUTPUT ARGS : out - description (truncated to size)           ***
+********************************************************************/
+void describeSite(const Site &s, char *out, size_t size) {
+    for (int i = FIRST_CALLER; i < s.depth; ++i) {
+        uintptr_t off = binaryOffset(s.frames[i]);
+        if (!off) continue;
+        if (const Resolved *r = lookup(off)) {
+            if (strncmp(r->location, "/usr/", 5) == 0 || r->location[0] == '?') continue;
+            const char *file = strrchr(r->location, '/');
+            int len = (int)strcspn(r->function, "(");     // drop the parameter list
+            snprintf(out, size, "%.*s (%s)", len, r->function, file ? file + 1 : r->location);
+            return;
+        }
+        Dl_info info;
+        dladdr((char*)s.frames[i] - 1, &info);
+        if (info.dli_sname && isLibrarySymbol(info.dli_sname)) continue;
+        const char *binary = strrchr(info.dli_fname, '/');
+        binary = binary ? binary + 1 : info.dli_fname;
+        int status = 0;
+        char *name = info.dli_sname ? abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status)
+                                    : nullptr;
+        const char *shown = (status == 0 && name) ? name : info.dli_sname ? info.dli_sname : "?";
+        snprintf(out, size, "%.*s (%s+0x%lx)", (int)strcspn(shown, "("), shown, binary,
+                 (unsigned long)off);
+        free(name);
+        return;
+    }
+    snprintf(out, size, "(library only)");
+}
+
+/********************************************************************
+*** FUNCTION report                                               ***
+*********************************************************************
+*** DESCRIPTION : At exit: allocations and bytes per phase, then  ***
+***               the TOP_SITES call sites by allocation count    ***
+***               (slots resolving to the same site and phase are ***
+***               merged), on stderr.                             ***
+********************************************************************/
+struct Reporter {
+    ~Reporter() { report(); }
+
+    static void report() {
+        std::lock_guard<std::mutex> g(siteLock);
+        long total = totalAllocs.load();
+        fprintf(stderr, "\nHEAP ALLOCATIONS: %ld calls, %ld bytes\n", total, totalBytes.load());
+        fprintf(stderr, "%-28s %12s %14s\n", "PHASE", "allocs", "bytes");
+        int n = phaseCount.load();
+        for (int i = 0; i < n; ++i) {
+            long a = phases[i].allocs.load();
+            if (a == 0) continue;
+            fprintf(stderr, "%-28s %12ld %14ld\n", i ? phases[i].name : "(no phase)",
+                    a, phases[i].bytes.load());
+        }
+
+        // Merge stacks that name the same site in the same phase
+        resolveFrames();
+        struct Row { char site[192]; int phase; long allocs, bytes; };
+        static Row rows[SITE_SLOTS];
+        int rowCount = 0;
+        for (const Site &s : sites) {
+            if (s.hash == 0) continue;
+            char name[192];
+            describeSite(s, name, sizeof(name));
+            int r = 0;
+            while (r < rowCount && (rows[r].phase != s.phase || strcmp(rows[r].site, name) != 0)) ++r;
+            if (r == rowCount) {
+                memcpy(rows[r].site, name, sizeof(name));
+                rows[r].phase = s.phase;
+                rows[r].allocs = rows[r].bytes = 0;
+                ++rowCount;
+            }
+            rows[r].allocs += s.allocs;
+            rows[r].bytes += s.bytes;
+        }
+        fprintf(stderr, "\nTOP ALLOCATION SITES\n%12s %14s  %-24s %s\n", "allocs", "bytes", "phase", "site");
+        for (int k = 0; k < TOP_SITES && k < rowCount; ++k) {
+            int best = k;
+            for (int r = k + 1; r < rowCount; ++r)
+                if (rows[r].allocs > rows[best].allocs) best = r;
+            if (best != k) { Row t = rows[k]; rows[k] = rows[best]; rows[best] = t; }
+            fprintf(stderr, "%12ld %14ld  %-24s %s\n", rows[k].allocs, rows[k].bytes,
+                    rows[k].phase ? phases[rows[k].phase].name : "(no phase)", rows[k].site);
+        }
+        if (overflowAllocs)
+            fprintf(stderr, "%12ld %14ld  (stacks beyond %d slots)\n", overflowAllocs,
+                    overflowBytes, SITE_SLOTS);
+    }
+};
+
+Reporter reporter;
+
+} // namespace
+
+AllocPhase::AllocPhase(const char *phase) : saved(currentPhase) {
+    if (phase) currentPhase = phaseIndex(phase);
+}
+
+AllocPhase::~AllocPhase() { currentPhase = saved; }
+
+long allocCount() { return totalAllocs.load(std::memory_order_relaxed); }
+
+void *operator new(size_t n) {
+    record(n);
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+/********************************************************************
+*** CLASS AllocPhase                                              ***
+*********************************************************************
+*** DESCRIPTION : Names the assembler phase this thread is in for ***
+***               the allocation accounting build (make           ***
+***               ALLOC_STATS=1). Every operator new is then      ***
+***               counted against the innermost live AllocPhase   ***
+***               and against its call site, and both tables are  ***
+***               printed on stderr at exit. PhaseTimer and       ***
+***               StopWatch carry one, so the --stats phases are  ***
+***               the accounting phases. In normal builds it is   ***
+***               empty and the hooks are not linked.             ***
+********************************************************************/
+#ifdef SICXE_ALLOC_STATS
+
+class AllocPhase {
+public:
+    explicit AllocPhase(const char *phase);   // null: keep the current phase
+    ~AllocPhase();
+    AllocPhase(const AllocPhase&) = delete;
+    AllocPhase& operator=(const AllocPhase&) = delete;
+
+private:
+    int saved;
+};
+
+// operator new calls in this process so far (all threads)
+long allocCount();
+
+#else
+
+class AllocPhase {
+public:
+    explicit AllocPhase(const char *) {}
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "Assembler.h"
+#include <exception>
+#include <sstream>
+#include <utility>
+#include "Pass1Core.h"
+#include "Intermediate.h"
+#include "SymbolFile.h"
+#include "SourceLexer.h"
+#include "OutputSink.h"
+
+/********************************************************************
+*** FUNCTION Assembler::assemble                                  ***
+*********************************************************************
+*** DESCRIPTION : Pass 1 over the text (no .int is written), the  ***
+***               rows of each control section handed to Pass 2   ***
+***               in memory, then the object program rendered     ***
+***               into records. Diagnostics are the records both  ***
+***               passes keep as each error is raised; if either  ***
+***               pass throws, the run ends with one saying so.   ***
+*** INPUT ARGS  : source - program text (need not end in '\n')    ***
+*** OUTPUT ARGS : out    - replaced with this source's results    ***
+*** RETURN      : bool   - true if there were no diagnostics      ***
+********************************************************************/
+bool Assembler::assemble(std::string_view source, AssemblyResult &out) const {
+    out = AssemblyResult();
+    int pass = 1;
+    try {
+        SourceLexer lexer;
+        lexer.attach(source);
+
+        // The passes record each diagnostic as {pass, line, message}; their
+        // text form is not needed here
+        Pass1Sections p1;
+        NullSink nullSink;
+        SinkStream noText(nullSink);
+        runPass1Sections(lexer, optab, p1, jobs, noText);
+        for (const auto &s : p1) {
+            const std::vector<Diagnostic> &d = s->result.diagnostics;
+            out.diagnostics.insert(out.diagnostics.end(), d.begin(), d.end());
+            std::vector<LiteralTable::Info> literals = s->littab.getLiterals();
+            out.literals.insert(out.literals.end(), literals.begin(), literals.end());
+        }
+
+        pass = 2;
+        loadProgramSections(p1, out.sections);
+        assembleSections(out.sections, optab, jobs);
+        for (const auto &s : out.sections)
+            out.diagnostics.insert(out.diagnostics.end(), s.prog.errors.begin(), s.prog.errors.end());
+
+        std::ostringstream obj;
+        writeObjectProgram(obj, out.sections);
+        std::istringstream records(obj.str());
+        for (std::string record; getline(records, record); ) out.records.push_back(std::move(record));
+    } catch (const std::exception &e) {
+        out.diagnostics.push_back(Diagnostic{pass, 0, std::string("assembly aborted (") + e.what() + ")"});
+    }
+    return !out.hasErrors();
+}
+
+std::string AssemblyResult::objectProgram() const {
+    std::string text;
+    for (const auto &record : records) {
+        text += record;
+        text += '\n';
+    }
+    return text;
+}
+
+void AssemblyResult::writeListing(std::ostream &os) const {
+    ::writeListing(os, sections);
+}
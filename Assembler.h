@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "OpcodeTable.h"
+#include "SymbolTable.h"
+#include "LiteralTable.h"
+#include "Pass2Core.h"
+#include "Diagnostic.h"
+
+/********************************************************************
+*** STRUCT AssemblyResult                                         ***
+*********************************************************************
+*** DESCRIPTION : Everything one Assembler::assemble call produces***
+***               in memory: per control section, the listing     ***
+***               lines and their object bytes (prog.image) and   ***
+***               the Pass 1 symbols (prog.symbols); the object   ***
+***               program as H/D/R/T/M/E records; and the         ***
+***               diagnostics of both passes in order.            ***
+********************************************************************/
+struct AssemblyResult {
+    // One per control section (just one without CSECT): lines, and
+    // prog with name, start, length, image, symbols (by name), EXTDEF/EXTREF.
+    // Each line's objOffset/objLen index its own section's prog.image.
+    std::vector<Pass2Section> sections;
+    std::vector<std::string> records;           // object program records, no newlines
+    std::vector<LiteralTable::Info> literals;   // each section's, by address
+    std::vector<Diagnostic> diagnostics;        // Pass 1, then Pass 2
+
+    bool hasErrors() const { return !diagnostics.empty(); }
+    // The .obj and .txt text exactly as Pass2 writes them
+    std::string objectProgram() const;
+    void writeListing(std::ostream &os) const;
+};
+
+/********************************************************************
+*** CLASS Assembler                                               ***
+*********************************************************************
+*** DESCRIPTION : In-memory SIC/XE assembler (libsicxe). Holds the***
+***               opcode table, built once, and runs Pass 1 and   ***
+***               Pass 2 over source text without touching the    ***
+***               filesystem. assemble() is const and may be      ***
+***               called from several threads at once.            ***
+********************************************************************/
+class Assembler {
+public:
+    // jobs > 1 splits each source's lexing and code generation across
+    // that many threads (same output)
+    explicit Assembler(int jobs = 1) : jobs(jobs < 1 ? 1 : jobs) {}
+
+    // false if the source produced diagnostics (out is complete either
+    // way). Never throws: if assembly is aborted (e.g. an operand stoi
+    // cannot convert), out holds what was done and a diagnostic saying so
+    bool assemble(std::string_view source, AssemblyResult &out) const;
+
+    const OpcodeTable &opcodes() const { return optab; }
+
+private:
+    OpcodeTable optab;
+    int jobs;
+};
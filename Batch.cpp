@@ -0,0 +1,263 @@
+#include "Batch.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include "SymbolTable.h"
+#include "LiteralTable.h"
+#include "Pass1Core.h"
+#include "Pass2Core.h"
+#include "Intermediate.h"
+#include "SymbolFile.h"
+#include "ThreadPool.h"
+#include "OutputSink.h"
+#include "RunStats.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point t0) {
+    return chrono::duration<double, milli>(Clock::now() - t0).count();
+}
+
+/********************************************************************
+*** FUNCTION assembleOne                                          ***
+*********************************************************************
+*** DESCRIPTION : Body of assembleFile (which adds the exception  ***
+***               guard); same arguments.                         ***
+********************************************************************/
+static void assembleOne(const string &source, const OpcodeTable &optab, const string &sinkKind,
+                        BatchFileResult &result, TraceLog *trace, const string *text,
+                        unsigned artifacts) {
+    Clock::time_point t0 = Clock::now();
+    result.source = source;
+    unique_ptr<RunStats> stats;
+    if (trace) {
+        stats.reset(new RunStats("sicxe", source));
+        stats->attachTrace(trace);
+    }
+
+    SourceLexer lexer;
+    string err;
+    if (text) lexer.attach(*text);
+    else if (!lexer.open(source, err)) {
+        result.failed = true;
+        result.failure = err;
+        result.totalMs = msSince(t0);
+        return;
+    }
+    string_view src = lexer.buffer();
+    result.lines = (long)count(src.begin(), src.end(), '\n') +
+                   (!src.empty() && src.back() != '\n' ? 1 : 0);
+
+    // Outputs that were not asked for go to a null sink
+    auto kindFor = [&](unsigned artifact) { return (artifacts & artifact) ? sinkKind : string("null"); };
+    auto produced = [&](unsigned artifact, const string &path) {
+        if ((artifacts & artifact) && sinkKind == "file") result.artifacts.push_back(path);
+    };
+
+    string baseName = source.substr(0, source.find_last_of('.'));
+    ostringstream diag;
+    Pass1Sections p1;
+    runPass1Sections(lexer, optab, p1, 1, diag, stats.get());
+
+    unique_ptr<OutputSink> intSink = makeSink(kindFor(ARTIFACT_INT), baseName + ".int", err);
+    if (intSink) {
+        PhaseTimer t(stats.get(), ".int + .sym write");
+        {
+            SinkStream os(*intSink);
+            writeIntermediate(os, p1);
+        }
+        if (intSink->finish(err)) {
+            produced(ARTIFACT_INT, baseName + ".int");
+            if ((artifacts & ARTIFACT_SYM) &&
+                writeSymbolFile(baseName + ".sym", p1, err))
+                produced(ARTIFACT_SYM, baseName + ".sym");
+        }
+    }
+    result.pass1Ms = msSince(t0);
+    bool pass1Errors = hasErrors(p1);
+    if (stats) {
+        long rows = 0;
+        for (const auto &s : p1) rows += (long)s->result.rows.size();
+        stats->setCount("rows", rows);
+    }
+
+    Clock::time_point t1 = Clock::now();
+    vector<Pass2Section> sections;
+    loadProgramSections(p1, sections);
+    {
+        PhaseTimer t(stats.get(), "code generation");
+        assembleSections(sections, optab);
+    }
+
+    if (err.empty()) {
+        unique_ptr<OutputSink> lst = makeSink(kindFor(ARTIFACT_TXT), baseName + ".txt", err);
+        unique_ptr<OutputSink> obj = lst ? makeSink(kindFor(ARTIFACT_OBJ), baseName + ".obj", err)
+                                         : nullptr;
+        if (lst && obj) {
+            PhaseTimer t(stats.get(), "listing + object write");
+            {
+                SinkStream os(*lst);
+                writeListing(os, sections);
+            }
+            {
+                SinkStream os(*obj);
+                writeObjectProgram(os, sections);
+            }
+            if (lst->finish(err)) {
+                produced(ARTIFACT_TXT, baseName + ".txt");
+                if (obj->finish(err)) produced(ARTIFACT_OBJ, baseName + ".obj");
+            }
+        }
+    }
+    result.pass2Ms = msSince(t1);
+
+    long imageBytes = 0, errorCount = 0;
+    for (const auto &sec : sections) {
+        for (const auto &e : sec.prog.errors) diag << e.text() << "\n";
+        imageBytes += (long)sec.prog.image.size();
+        errorCount += (long)sec.prog.errors.size();
+    }
+    result.diagnostics = diag.str();
+    result.hasErrors = pass1Errors || errorCount > 0;
+    if (!err.empty()) { result.failed = true; result.failure = err; }
+    result.totalMs = msSince(t0);
+    if (stats) {
+        stats->setCount("lines", result.lines);
+        stats->setCount("object bytes", imageBytes);
+        stats->setCount("errors", errorCount);
+        stats->traceRun();
+    }
+}
+
+/********************************************************************
+*** FUNCTION assembleFile                                         ***
+*********************************************************************
+*** DESCRIPTION : Runs both passes on one source in memory and    ***
+***               writes <base>.int, .sym, .txt and .obj next to  ***
+***               it. Nothing is printed; messages are collected  ***
+***               in result.diagnostics. If assembly throws (e.g. ***
+***               an operand stoi cannot convert), the source is  ***
+***               marked failed and the caller carries on.        ***
+*** INPUT ARGS  : source   - .asm path                            ***
+***               optab    - shared opcode table                  ***
+***               sinkKind - where .int/.txt/.obj go (see makeSink)***
+***               trace    - if not null, gets a span for the file***
+***                          and its phases on this thread        ***
+***               text     - source text (null: read source)      ***
+***               artifacts - ARTIFACT_* mask of outputs to write ***
+*** OUTPUT ARGS : result - timings, diagnostics, status, the files***
+***                        written                                ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void assembleFile(const string &source, const OpcodeTable &optab, const string &sinkKind,
+                  BatchFileResult &result, TraceLog *trace, const string *text,
+                  unsigned artifacts) {
+    Clock::time_point t0 = Clock::now();
+    try {
+        assembleOne(source, optab, sinkKind, result, trace, text, artifacts);
+    } catch (const exception &e) {
+        result.failed = true;
+        result.failure = string("assembly aborted (") + e.what() + ")";
+        result.totalMs = msSince(t0);
+    }
+}
+
+/********************************************************************
+*** FUNCTION readManifest                                         ***
+*********************************************************************
+*** DESCRIPTION : Reads source paths from a manifest file, one    ***
+***               per line (surrounding blanks trimmed).          ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : sources (appended), err                         ***
+*** RETURN      : bool - false if the manifest cannot be read     ***
+********************************************************************/
+bool readManifest(const string &path, vector<string> &sources, string &err) {
+    ifstream in(path);
+    if (!in) { err = "cannot open manifest " + path; return false; }
+    string line;
+    while (getline(in, line)) {
+        size_t b = line.find_first_not_of(" \t\r");
+        if (b == string::npos || line[b] == '#') continue;
+        size_t e = line.find_last_not_of(" \t\r");
+        sources.push_back(line.substr(b, e - b + 1));
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION runBatch                                             ***
+*********************************************************************
+*** DESCRIPTION : Assembles every source as one task on a work-   ***
+***               stealing pool sharing one OpcodeTable, then     ***
+***               reports per-file diagnostics and a per-file and ***
+***               aggregate timing summary in input order.        ***
+*** INPUT ARGS  : sources  - .asm paths                           ***
+***               jobs     - worker threads                       ***
+***               sinkKind - where each file's artifacts go       ***
+***               trace    - per-file spans (may be null)         ***
+*** OUTPUT ARGS : out  - timing summary                           ***
+***               diag - per-file diagnostics                     ***
+*** RETURN      : bool - false if any source failed outright      ***
+********************************************************************/
+bool runBatch(const vector<string> &sources, int jobs, const string &sinkKind,
+              ostream &out, ostream &diag, TraceLog *trace) {
+    const OpcodeTable optab;
+    vector<BatchFileResult> results(sources.size());
+
+    Clock::time_point t0 = Clock::now();
+    {
+        ThreadPool pool(jobs);
+        pool.parallelFor(sources.size(), [&](size_t i) {
+            assembleFile(sources[i], optab, sinkKind, results[i], trace);
+        });
+    }
+    double wallMs = msSince(t0);
+
+    long totalLines = 0;
+    double cpuMs = 0;
+    int withErrors = 0, failed = 0;
+    for (const auto &r : results) {
+        if (!r.diagnostics.empty() || r.failed) {
+            diag << "== " << r.source << "\n" << r.diagnostics;
+            if (r.failed) diag << "Error: " << r.failure << "\n";
+        }
+        totalLines += r.lines;
+        cpuMs += r.totalMs;
+        if (r.failed) ++failed;
+        else if (r.hasErrors) ++withErrors;
+    }
+
+    size_t nameWidth = 6;
+    for (const auto &r : results) nameWidth = max(nameWidth, r.source.size() + 2);
+
+    out << "\n========== BATCH SUMMARY ==========\n";
+    out << left << setw((int)nameWidth) << "SOURCE"
+        << right << setw(10) << "LINES"
+        << setw(11) << "PASS1 ms" << setw(11) << "PASS2 ms" << setw(11) << "TOTAL ms"
+        << "  STATUS\n";
+    out << fixed << setprecision(2);
+    for (const auto &r : results) {
+        out << left << setw((int)nameWidth) << r.source
+            << right << setw(10) << r.lines
+            << setw(11) << r.pass1Ms << setw(11) << r.pass2Ms << setw(11) << r.totalMs
+            << "  " << (r.failed ? "FAILED" : r.hasErrors ? "errors" : "ok") << "\n";
+    }
+    out << "\nFiles: " << results.size() << " (" << failed << " failed, "
+        << withErrors << " with errors)"
+        << "  Lines: " << totalLines
+        << "  Threads: " << jobs << "\n";
+    out << "Wall: " << wallMs << " ms  Sum of file times: " << cpuMs << " ms";
+    if (wallMs > 0)
+        out << "  Throughput: " << setprecision(0) << (results.size() * 1000.0 / wallMs)
+            << " files/s, " << (totalLines * 1000.0 / wallMs) << " lines/s";
+    out << "\n";
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+    return failed == 0;
+}
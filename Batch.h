@@ -0,0 +1,54 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "OpcodeTable.h"
+
+class TraceLog;
+
+/********************************************************************
+*** STRUCT BatchFileResult                                        ***
+*********************************************************************
+*** DESCRIPTION : Outcome of assembling one source in batch mode: ***
+***               timings, the diagnostics both passes produced   ***
+***               (in order), and a failure reason if outputs     ***
+***               could not be produced at all.                   ***
+********************************************************************/
+struct BatchFileResult {
+    std::string source;
+    bool   failed = false;      // could not read the source or write outputs
+    bool   hasErrors = false;   // assembled, but with diagnostics
+    long   lines = 0;
+    double pass1Ms = 0, pass2Ms = 0, totalMs = 0;
+    std::string diagnostics;    // Pass 1 messages, then Pass 2 errors
+    std::string failure;
+    std::vector<std::string> artifacts;     // files written, in .int/.sym/.txt/.obj order
+};
+
+// Artifacts assembleFile writes (bit mask; the rest are not produced)
+enum {
+    ARTIFACT_INT = 1, ARTIFACT_SYM = 2, ARTIFACT_TXT = 4, ARTIFACT_OBJ = 8,
+    ARTIFACT_ALL = 15
+};
+
+// Assemble one source to <base>.int/.sym/.txt/.obj without console output;
+// the text artifacts go to sinks of sinkKind (file, memory or null). With a
+// trace, the file and its phases become spans on the calling thread. With
+// text, that is the source and the source path only names the outputs.
+// Nothing escapes: if assembly throws, result is marked failed.
+void assembleFile(const std::string &source, const OpcodeTable &optab,
+                  const std::string &sinkKind, BatchFileResult &result,
+                  TraceLog *trace = nullptr, const std::string *text = nullptr,
+                  unsigned artifacts = ARTIFACT_ALL);
+
+// Read a manifest: one source path per line; blank lines and '#' comments skipped
+bool readManifest(const std::string &path, std::vector<std::string> &sources,
+                  std::string &err);
+
+// Assemble all sources on a jobs-thread work-stealing pool with one shared
+// OpcodeTable; diagnostics go to diag and the timing summary to out, both in
+// input order. Returns false if any source failed outright.
+bool runBatch(const std::vector<std::string> &sources, int jobs,
+              const std::string &sinkKind, std::ostream &out, std::ostream &diag,
+              TraceLog *trace = nullptr);
@@ -0,0 +1,248 @@
+#include "Daemon.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Batch.h"
+
+namespace {
+
+const struct { const char *name; unsigned bit; } ARTIFACT_NAMES[] = {
+    {"int", ARTIFACT_INT}, {"sym", ARTIFACT_SYM}, {"txt", ARTIFACT_TXT}, {"obj", ARTIFACT_OBJ},
+};
+
+// Largest inline source or payload accepted (guards against a bad length)
+const size_t MAX_PAYLOAD = 1u << 30;
+const size_t MAX_LINE = 16 * 1024;         // a header line: a path and a few words
+
+// "<word> <rest of line>": word removed from line
+std::string nextWord(std::string &line) {
+    size_t sp = line.find(' ');
+    std::string word = line.substr(0, sp);
+    line = (sp == std::string::npos) ? "" : line.substr(sp + 1);
+    return word;
+}
+
+bool parseSize(const std::string &s, size_t &n) {
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) return false;
+    n = (size_t)strtoull(s.c_str(), nullptr, 10);
+    return n <= MAX_PAYLOAD;
+}
+
+} // namespace
+
+std::string defaultDaemonSocket() {
+    const char *env = getenv("SICXED_SOCKET");
+    if (env && *env) return env;
+    return "/tmp/sicxed-" + std::to_string((long)getuid()) + ".sock";
+}
+
+bool parseArtifactList(const std::string &list, unsigned &mask) {
+    mask = 0;
+    if (list == "all") { mask = ARTIFACT_ALL; return true; }
+    std::istringstream in(list);
+    std::string name;
+    while (getline(in, name, ',')) {
+        if (name == "lst") name = "txt";
+        unsigned bit = 0;
+        for (const auto &a : ARTIFACT_NAMES)
+            if (name == a.name) bit = a.bit;
+        if (!bit) return false;
+        mask |= bit;
+    }
+    return mask != 0;
+}
+
+std::string artifactListFor(unsigned mask) {
+    if (mask == ARTIFACT_ALL) return "all";
+    std::string list;
+    for (const auto &a : ARTIFACT_NAMES) {
+        if (!(mask & a.bit)) continue;
+        if (!list.empty()) list += ',';
+        list += a.name;
+    }
+    return list;
+}
+
+bool DaemonStream::fill(std::string &err) {
+    if (pos > 0) { buf.erase(0, pos); pos = 0; }
+    char chunk[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { err = std::string("socket read: ") + strerror(errno); return false; }
+        if (n == 0) return false;
+        buf.append(chunk, (size_t)n);
+        return true;
+    }
+}
+
+bool DaemonStream::readLine(std::string &line, std::string &err) {
+    for (;;) {
+        size_t nl = buf.find('\n', pos);
+        if (nl != std::string::npos) {
+            line.assign(buf, pos, nl - pos);
+            pos = nl + 1;
+            return true;
+        }
+        if (buf.size() - pos > MAX_LINE) { err = "header line too long"; return false; }
+        if (!fill(err)) {
+            if (err.empty() && pos < buf.size()) err = "connection closed mid-message";
+            return false;
+        }
+    }
+}
+
+bool DaemonStream::readBytes(size_t n, std::string &out, std::string &err) {
+    while (buf.size() - pos < n) {
+        if (!fill(err)) {
+            if (err.empty()) err = "connection closed mid-message";
+            return false;
+        }
+    }
+    out.assign(buf, pos, n);
+    pos += n;
+    return true;
+}
+
+bool DaemonStream::writeAll(const std::string &data, std::string &err) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { err = std::string("socket write: ") + strerror(errno); return false; }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION DaemonStream::readRequest                            ***
+*********************************************************************
+*** DESCRIPTION : Reads one request header (and TEXT payload).    ***
+*** OUTPUT ARGS : req, err                                        ***
+*** RETURN      : bool - false at end of stream (err empty) or on ***
+***               a malformed request (err set)                   ***
+********************************************************************/
+bool DaemonStream::readRequest(DaemonRequest &req, std::string &err) {
+    std::string line;
+    if (!readLine(line, err)) return false;
+    req = DaemonRequest();
+    std::string verb = nextWord(line);
+    if (verb == "STATS") { req.kind = DaemonRequest::STATS; return true; }
+    if (verb == "SHUTDOWN") { req.kind = DaemonRequest::SHUTDOWN; return true; }
+    if (verb != "ASSEMBLE" && verb != "TEXT") { err = "unknown request '" + verb + "'"; return false; }
+
+    if (!parseArtifactList(nextWord(line), req.artifacts)) { err = "bad output list"; return false; }
+    size_t n = 0;
+    if (verb == "TEXT") {
+        req.hasText = true;
+        if (!parseSize(nextWord(line), n)) { err = "bad TEXT length"; return false; }
+    }
+    req.path = line;
+    if (req.path.empty()) { err = "missing source path"; return false; }
+    return !req.hasText || readBytes(n, req.text, err);
+}
+
+bool DaemonStream::writeRequest(const DaemonRequest &req, std::string &err) {
+    switch (req.kind) {
+    case DaemonRequest::STATS:    return writeAll("STATS\n", err);
+    case DaemonRequest::SHUTDOWN: return writeAll("SHUTDOWN\n", err);
+    case DaemonRequest::ASSEMBLE: break;
+    }
+    std::string outputs = artifactListFor(req.artifacts);
+    if (!req.hasText) return writeAll("ASSEMBLE " + outputs + " " + req.path + "\n", err);
+    return writeAll("TEXT " + outputs + " " + std::to_string(req.text.size()) + " " +
+                    req.path + "\n", err) &&
+           writeAll(req.text, err);
+}
+
+/********************************************************************
+*** FUNCTION DaemonStream::readResponse                           ***
+*********************************************************************
+*** DESCRIPTION : Reads STATUS, the optional payloads and the     ***
+***               artifact lines up to END.                       ***
+*** OUTPUT ARGS : resp, err                                       ***
+*** RETURN      : bool - false if the response is cut off or      ***
+***               malformed                                       ***
+********************************************************************/
+bool DaemonStream::readResponse(DaemonResponse &resp, std::string &err) {
+    resp = DaemonResponse();
+    std::string line;
+    if (!readLine(line, err)) {
+        if (err.empty()) err = "daemon closed the connection";
+        return false;
+    }
+    if (nextWord(line) != "STATUS") { err = "bad response from daemon"; return false; }
+    resp.status = nextWord(line);
+    resp.ms = atof(line.c_str());
+    for (;;) {
+        if (!readLine(line, err)) {
+            if (err.empty()) err = "daemon closed the connection";
+            return false;
+        }
+        std::string word = nextWord(line);
+        if (word == "END") return true;
+        if (word == "ARTIFACT") { resp.artifacts.push_back(line); continue; }
+        size_t n = 0;
+        if ((word != "DIAG" && word != "REPORT") || !parseSize(line, n)) {
+            err = "bad response from daemon";
+            return false;
+        }
+        if (!readBytes(n, word == "DIAG" ? resp.diagnostics : resp.report, err)) return false;
+    }
+}
+
+bool DaemonStream::writeResponse(const DaemonResponse &resp, std::string &err) {
+    std::ostringstream os;
+    os << "STATUS " << resp.status << " " << std::fixed << std::setprecision(3) << resp.ms << "\n";
+    if (!resp.diagnostics.empty())
+        os << "DIAG " << resp.diagnostics.size() << "\n" << resp.diagnostics;
+    if (!resp.report.empty())
+        os << "REPORT " << resp.report.size() << "\n" << resp.report;
+    for (const auto &path : resp.artifacts) os << "ARTIFACT " << path << "\n";
+    os << "END\n";
+    return writeAll(os.str(), err);
+}
+
+void LatencyLog::record(double ms) {
+    std::lock_guard<std::mutex> g(lock);
+    samples.push_back(ms);
+}
+
+/********************************************************************
+*** FUNCTION LatencyLog::report                                   ***
+*********************************************************************
+*** DESCRIPTION : One line: request count, mean and nearest-rank  ***
+***               percentiles of the latencies so far.            ***
+*** INPUT ARGS  : os - destination                                ***
+********************************************************************/
+void LatencyLog::report(std::ostream &os) const {
+    std::vector<double> sorted;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        sorted = samples;
+    }
+    os << "Requests: " << sorted.size();
+    if (sorted.empty()) { os << "\n"; return; }
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double v : sorted) sum += v;
+    auto pct = [&](double p) {
+        size_t rank = (size_t)std::max(1.0, std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(rank, sorted.size()) - 1];
+    };
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize prec = os.precision();
+    os << std::fixed << std::setprecision(3)
+       << "  latency ms: mean " << sum / sorted.size()
+       << "  p50 " << pct(50) << "  p90 " << pct(90) << "  p99 " << pct(99)
+       << "  max " << sorted.back() << "\n";
+    os.flags(flags);
+    os.precision(prec);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/********************************************************************
+*** Wire protocol between sicxed and its client sicxec, over a    ***
+*** Unix stream socket. Text header lines, with length-prefixed   ***
+*** payloads for anything that may contain newlines:              ***
+***                                                               ***
+***   ASSEMBLE <outputs> <path>\n         assemble a source file  ***
+***   TEXT <outputs> <n> <path>\n<n bytes> assemble inline text;  ***
+***                                       path names the outputs  ***
+***   STATS\n                             latency report          ***
+***   SHUTDOWN\n                          stop the daemon         ***
+***                                                               ***
+*** <outputs> is "all" or a comma list of int, sym, txt, obj.     ***
+*** Every request is answered with                                ***
+***                                                               ***
+***   STATUS ok|errors|failed <ms>\n                              ***
+***   [DIAG <n>\n<n bytes>] [REPORT <n>\n<n bytes>]               ***
+***   ARTIFACT <path>\n ...                                       ***
+***   END\n                                                       ***
+***                                                               ***
+*** A connection may carry any number of requests in turn.        ***
+********************************************************************/
+
+struct DaemonRequest {
+    enum Kind { ASSEMBLE, STATS, SHUTDOWN };
+    Kind kind = ASSEMBLE;
+    std::string path;           // absolute, so the daemon's cwd does not matter
+    bool hasText = false;       // TEXT: the source is text, not the file at path
+    std::string text;
+    unsigned artifacts = 0;     // ARTIFACT_* mask (Batch.h)
+};
+
+struct DaemonResponse {
+    std::string status;         // ok, errors or failed
+    double ms = 0;              // assembly time inside the daemon
+    std::string diagnostics;    // both passes' messages, or the failure reason
+    std::string report;         // STATS: the latency report
+    std::vector<std::string> artifacts;
+};
+
+// $SICXED_SOCKET, else /tmp/sicxed-<uid>.sock
+std::string defaultDaemonSocket();
+
+// "all" or a comma list of int, sym, txt (lst), obj -> ARTIFACT_* mask
+bool parseArtifactList(const std::string &list, unsigned &mask);
+std::string artifactListFor(unsigned mask);
+
+/********************************************************************
+*** CLASS DaemonStream                                            ***
+*********************************************************************
+*** DESCRIPTION : One end of a sicxed connection: buffered reads  ***
+***               of header lines (16 KiB at most) and payloads,  ***
+***               whole writes.                                   ***
+***               Does not own the descriptor.                    ***
+********************************************************************/
+class DaemonStream {
+public:
+    explicit DaemonStream(int fd) : fd(fd) {}
+
+    // false at end of stream (err empty) or on a malformed/failed read
+    bool readRequest(DaemonRequest &req, std::string &err);
+    bool readResponse(DaemonResponse &resp, std::string &err);
+    bool writeRequest(const DaemonRequest &req, std::string &err);
+    bool writeResponse(const DaemonResponse &resp, std::string &err);
+
+private:
+    bool fill(std::string &err);
+    bool readLine(std::string &line, std::string &err);
+    bool readBytes(size_t n, std::string &out, std::string &err);
+    bool writeAll(const std::string &data, std::string &err);
+
+    int fd;
+    std::string buf;
+    size_t pos = 0;
+};
+
+/********************************************************************
+*** CLASS LatencyLog                                              ***
+*********************************************************************
+*** DESCRIPTION : Per-request latencies (thread-safe), reported   ***
+***               as count, mean and p50/p90/p99/max.             ***
+********************************************************************/
+class LatencyLog {
+public:
+    void record(double ms);
+    void report(std::ostream &os) const;
+
+private:
+    mutable std::mutex lock;
+    std::vector<double> samples;
+};
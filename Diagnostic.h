@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+/********************************************************************
+*** STRUCT Diagnostic                                             ***
+*********************************************************************
+*** DESCRIPTION : One assembler message, recorded where the pass  ***
+***               raises it: the pass, the line it is about       ***
+***               (Pass 1: source line; Pass 2: the LINE# of the  ***
+***               intermediate row; 0 if none) and the text       ***
+***               without a line prefix.                          ***
+********************************************************************/
+struct Diagnostic {
+    int pass = 1;               // 1 or 2
+    int line = 0;
+    std::string message;
+
+    // "Line <n>: <message>" (just the message without a line), the way
+    // Pass 2 prints its errors
+    std::string text() const {
+        return line > 0 ? "Line " + std::to_string(line) + ": " + message : message;
+    }
+};
@@ -0,0 +1,81 @@
+#include "FileWatcher.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) ::close(fd);
+}
+
+/********************************************************************
+*** FUNCTION FileWatcher::open                                    ***
+*********************************************************************
+*** DESCRIPTION : Starts watching path's directory for writes,    ***
+***               creations and renames.                          ***
+*** INPUT ARGS  : path - file to watch                            ***
+*** OUTPUT ARGS : err  - reason on failure                        ***
+*** RETURN      : bool - true if the watch is in place            ***
+********************************************************************/
+bool FileWatcher::open(const std::string &path, std::string &err) {
+    size_t slash = path.find_last_of('/');
+    std::string dir = (slash == std::string::npos) ? "." : path.substr(0, slash + 1);
+    name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        err = std::string("inotify_init1: ") + std::strerror(errno);
+        return false;
+    }
+    if (inotify_add_watch(fd, dir.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0) {
+        err = "cannot watch " + dir + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool FileWatcher::drain(std::string &err) {
+    alignas(inotify_event) char buf[16 * 1024];
+    ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n < 0) {
+        if (errno == EINTR || errno == EAGAIN) return false;
+        err = std::string("inotify read: ") + std::strerror(errno);
+        failed = true;
+        return false;
+    }
+    bool ours = false;
+    for (char *p = buf; p < buf + n; ) {
+        const inotify_event *ev = reinterpret_cast<const inotify_event*>(p);
+        if (ev->len > 0 && name == ev->name) ours = true;
+        p += sizeof(inotify_event) + ev->len;
+    }
+    return ours;
+}
+
+/********************************************************************
+*** FUNCTION FileWatcher::wait                                    ***
+*********************************************************************
+*** DESCRIPTION : Blocks for the first event on the file, then    ***
+***               keeps reading events until quietMs go by with   ***
+***               none for the file.                              ***
+*** INPUT ARGS  : quietMs - coalescing window                     ***
+*** OUTPUT ARGS : err - reason on failure                         ***
+*** RETURN      : bool - true once the file changed and settled   ***
+********************************************************************/
+bool FileWatcher::wait(int quietMs, std::string &err) {
+    pollfd pfd = {fd, POLLIN, 0};
+    bool changed = false;
+    for (;;) {
+        int ready = poll(&pfd, 1, changed ? quietMs : -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            err = std::string("poll: ") + std::strerror(errno);
+            return false;
+        }
+        if (ready == 0) return true;            // quiet for quietMs after a change
+        if (drain(err)) changed = true;
+        if (failed) return false;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+/********************************************************************
+*** CLASS FileWatcher                                             ***
+*********************************************************************
+*** DESCRIPTION : Waits for a file to change (sicxe --watch). The ***
+***               file's directory is watched with inotify and    ***
+***               events are filtered by name, so editors that    ***
+***               save by writing a new file and renaming it over ***
+***               the old one are seen too. A burst of writes is  ***
+***               coalesced: wait() returns only once the file has***
+***               been quiet for the given time.                  ***
+********************************************************************/
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool open(const std::string &path, std::string &err);
+    // Blocks until the file changes, then until quietMs pass without
+    // another change. false + err if the watch fails
+    bool wait(int quietMs, std::string &err);
+
+private:
+    // Reads the pending events; true if any of them is about our file
+    bool drain(std::string &err);
+
+    int fd = -1;
+    std::string name;          // file name within the watched directory
+    bool failed = false;
+};
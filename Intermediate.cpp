@@ -0,0 +1,286 @@
+#include "Intermediate.h"
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include "MappedFile.h"
+#include "OutputBuffer.h"
+
+using namespace std;
+
+/********************************************************************
+*** FUNCTION rowToLine                                            ***
+*********************************************************************
+*** DESCRIPTION : Converts a Pass 1 intermediate row straight into ***
+***               a Pass 2 listing line, applying the same         ***
+***               normalization a .int write/parseListing round    ***
+***               trip would (colon label, uppercased op, masked   ***
+***               LOCCTR). Rows whose text form would not split    ***
+***               back cleanly (over-wide columns, op that looks   ***
+***               like a label) go through the text path so the    ***
+***               result stays identical to the two-binary flow.   ***
+*** INPUT ARGS  : row - intermediate row (consumed)               ***
+*** OUTPUT ARGS : out - listing line for Pass 2                   ***
+*** RETURN      : bool - false if Pass 2 would drop the row       ***
+********************************************************************/
+bool rowToLine(IntermediateRow row, Line &out) {
+    const string &op = row.opcode;
+    bool opLooksLikeLabel = !op.empty() && (op == "*" || op.back() == ':');
+    if (row.label.size() >= 10 || op.size() >= 12 ||
+        (row.label.empty() && opLooksLikeLabel) || row.lineNum < 0) {
+        ostringstream text;
+        {
+            OutputBuffer buf(text, 256);
+            writeLine(buf, row);
+        }
+        return parseListing(text.str(), out);
+    }
+    if (op.empty()) return false;
+
+    out.lineNum = row.lineNum;
+    out.locctr  = row.locctr & 0xFFFFF;
+    out.label = std::move(row.label);
+    if (!out.label.empty() && out.label != "*" && out.label.back() != ':')
+        out.label += ':';
+    out.op = std::move(row.opcode);
+    for (char &c : out.op) c = toupper((unsigned char)c);
+    out.operand = std::move(row.operand);
+    out.isLiteral = (out.label == "*");
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION writeIntermediateBinary                              ***
+*********************************************************************
+*** DESCRIPTION : Writes the Pass 1 rows as a fixed-layout .intb: ***
+***               header, row array, interned string table. Pass  ***
+***               2 rebuilds each line from the strings, as it    ***
+***               would from the .int. Control sections follow    ***
+***               one another in the rows (Pass 2 splits them at  ***
+***               CSECT); the header has the first one's start    ***
+***               and length.                                     ***
+*** INPUT ARGS  : path, result (or sections)                      ***
+*** OUTPUT ARGS : err - reason on failure                         ***
+*** RETURN      : bool - true if written                          ***
+********************************************************************/
+static bool writeRows(const string &path, const vector<const Pass1Result*> &results,
+                      string &err) {
+    string strings;
+    unordered_map<string, intb::StrRef> interned;
+    auto intern = [&](const string &s) {
+        auto it = interned.find(s);
+        if (it != interned.end()) return it->second;
+        intb::StrRef ref;
+        ref.offset = (uint32_t)strings.size();
+        ref.length = (uint32_t)s.size();
+        strings += s;
+        interned.emplace(s, ref);
+        return ref;
+    };
+
+    size_t total = 0;
+    for (const Pass1Result *result : results) total += result->rows.size();
+    vector<intb::Row> rows;
+    rows.reserve(total);
+    for (const Pass1Result *result : results) for (const auto &r : result->rows) {
+        intb::Row row;
+        memset(&row, 0, sizeof(row));
+        row.lineNum = r.lineNum;
+        row.locctr  = r.locctr;
+        row.label   = intern(r.label);
+        row.opcode  = intern(r.opcode);
+        row.operand = intern(r.operand);
+        rows.push_back(row);
+    }
+
+    intb::Header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, intb::MAGIC, sizeof(hdr.magic));
+    hdr.version       = intb::VERSION;
+    hdr.rowCount      = (uint32_t)rows.size();
+    hdr.stringBytes   = (uint32_t)strings.size();
+    hdr.startAddress  = results.front()->startAddress;
+    hdr.programLength = results.front()->programLength;
+
+    ofstream out(path, ios::binary);
+    if (!out) { err = "cannot open " + path + " for writing"; return false; }
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    if (!rows.empty())
+        out.write(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(intb::Row));
+    out.write(strings.data(), strings.size());
+    if (!out) { err = "write failed for " + path; return false; }
+    return true;
+}
+
+bool writeIntermediateBinary(const string &path, const Pass1Result &result, string &err) {
+    return writeRows(path, {&result}, err);
+}
+
+bool writeIntermediateBinary(const string &path, const Pass1Sections &sections, string &err) {
+    vector<const Pass1Result*> results;
+    for (const auto &s : sections) results.push_back(&s->result);
+    return writeRows(path, results, err);
+}
+
+// True if every string a row references lies inside the string table
+static bool rowInRange(const intb::Row &r, const intb::Header &hdr) {
+    const intb::StrRef refs[3] = { r.label, r.opcode, r.operand };
+    for (const auto &ref : refs)
+        if ((uint64_t)ref.offset + ref.length > hdr.stringBytes) return false;
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION checkedView                                          ***
+*********************************************************************
+*** DESCRIPTION : Validates the header of a mapped .intb and      ***
+***               locates its row array and string table. Row     ***
+***               string references are checked unless checkRows  ***
+***               is false (the caller then checks each row).     ***
+*** INPUT ARGS  : map, path, checkRows                            ***
+*** OUTPUT ARGS : hdr, rows, strings, err                         ***
+*** RETURN      : bool - false if the file is not a usable .intb  ***
+********************************************************************/
+static bool checkedView(const MappedFile &map, const string &path,
+                        intb::Header &hdr, const intb::Row *&rows,
+                        const char *&strings, string &err, bool checkRows = true) {
+    if (map.size() < sizeof(intb::Header)) {
+        err = path + ": too small to be a .intb file";
+        return false;
+    }
+    memcpy(&hdr, map.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, intb::MAGIC, sizeof(hdr.magic)) != 0) {
+        err = path + ": not a .intb file (bad magic)";
+        return false;
+    }
+    if (hdr.version != intb::VERSION) {
+        ostringstream oss;
+        oss << path << ": stale .intb (version " << hdr.version
+            << ", expected " << intb::VERSION << ") - rerun Pass1";
+        err = oss.str();
+        return false;
+    }
+    uint64_t need = sizeof(intb::Header) + (uint64_t)hdr.rowCount * sizeof(intb::Row)
+                  + hdr.stringBytes;
+    if (need != map.size()) {
+        err = path + ": truncated or corrupt .intb";
+        return false;
+    }
+    rows = reinterpret_cast<const intb::Row*>(map.data() + sizeof(intb::Header));
+    strings = map.data() + sizeof(intb::Header) + (size_t)hdr.rowCount * sizeof(intb::Row);
+    for (uint32_t i = 0; checkRows && i < hdr.rowCount; ++i) {
+        if (!rowInRange(rows[i], hdr)) {
+            err = path + ": string reference out of range";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Listing line for row i of a validated .intb (false if Pass 2 drops it)
+static bool lineFromRow(const intb::Row &r, const char *strings, Line &L) {
+    IntermediateRow row;
+    row.lineNum = r.lineNum;
+    row.locctr  = r.locctr;
+    row.label.assign(strings + r.label.offset, r.label.length);
+    row.opcode.assign(strings + r.opcode.offset, r.opcode.length);
+    row.operand.assign(strings + r.operand.offset, r.operand.length);
+    return rowToLine(std::move(row), L);
+}
+
+/********************************************************************
+*** FUNCTION loadIntermediateBinary                               ***
+*********************************************************************
+*** DESCRIPTION : Maps a .intb and walks its rows into Pass 2     ***
+***               listing lines; no text is tokenized.            ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : lines, err                                      ***
+*** RETURN      : bool - true if loaded                           ***
+********************************************************************/
+bool loadIntermediateBinary(const string &path, vector<Line> &lines, string &err) {
+    MappedFile map;
+    if (!map.open(path, err)) return false;
+    intb::Header hdr;
+    const intb::Row *rows = nullptr;
+    const char *strings = nullptr;
+    if (!checkedView(map, path, hdr, rows, strings, err)) return false;
+
+    lines.reserve(lines.size() + hdr.rowCount);
+    for (uint32_t i = 0; i < hdr.rowCount; ++i) {
+        Line L;
+        if (lineFromRow(rows[i], strings, L)) lines.push_back(std::move(L));
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION forEachIntermediateBinaryLine                        ***
+*********************************************************************
+*** DESCRIPTION : Like loadIntermediateBinary, but hands each     ***
+***               line to fn as it is decoded instead of keeping  ***
+***               them. Row pages already walked are released, so ***
+***               resident memory stays flat for any file size.   ***
+*** INPUT ARGS  : path, fn - called once per line, in order       ***
+*** OUTPUT ARGS : err                                             ***
+*** RETURN      : bool - true if the whole file was walked        ***
+********************************************************************/
+bool forEachIntermediateBinaryLine(const string &path, const function<void(Line&)> &fn,
+                                   string &err) {
+    MappedFile map;
+    if (!map.open(path, err)) return false;
+    intb::Header hdr;
+    const intb::Row *rows = nullptr;
+    const char *strings = nullptr;
+    if (!checkedView(map, path, hdr, rows, strings, err, false)) return false;
+
+    const uint32_t RELEASE_ROWS = 1u << 15;   // ~1 MB of rows
+    for (uint32_t i = 0; i < hdr.rowCount; ++i) {
+        if (!rowInRange(rows[i], hdr)) {
+            err = path + ": string reference out of range";
+            return false;
+        }
+        Line L;
+        if (lineFromRow(rows[i], strings, L)) fn(L);
+        if ((i + 1) % RELEASE_ROWS == 0)
+            map.release(sizeof(intb::Header) + (size_t)(i + 1 - RELEASE_ROWS) * sizeof(intb::Row),
+                        (size_t)RELEASE_ROWS * sizeof(intb::Row));
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION readIntermediateBinaryRows                           ***
+*********************************************************************
+*** DESCRIPTION : Reads a .intb back into Pass 1 rows so it can   ***
+***               be re-emitted as the text .int for debugging.   ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : result, err                                     ***
+*** RETURN      : bool - true if read                             ***
+********************************************************************/
+bool readIntermediateBinaryRows(const string &path, Pass1Result &result, string &err) {
+    MappedFile map;
+    if (!map.open(path, err)) return false;
+    intb::Header hdr;
+    const intb::Row *rows = nullptr;
+    const char *strings = nullptr;
+    if (!checkedView(map, path, hdr, rows, strings, err)) return false;
+
+    result.startAddress  = hdr.startAddress;
+    result.programLength = hdr.programLength;
+    result.rows.clear();
+    result.rows.reserve(hdr.rowCount);
+    for (uint32_t i = 0; i < hdr.rowCount; ++i) {
+        const intb::Row &r = rows[i];
+        IntermediateRow row;
+        row.lineNum = r.lineNum;
+        row.locctr  = r.locctr;
+        row.label.assign(strings + r.label.offset, r.label.length);
+        row.opcode.assign(strings + r.opcode.offset, r.opcode.length);
+        row.operand.assign(strings + r.operand.offset, r.operand.length);
+        result.rows.push_back(std::move(row));
+    }
+    return true;
+}
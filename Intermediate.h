@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Pass1Core.h"
+#include "Pass2Core.h"
+
+/********************************************************************
+*** Binary intermediate (.intb) layout                            ***
+*********************************************************************
+*** Header | Row[rowCount] | string table (stringBytes)           ***
+*** All integers are native-endian; the file is only meant to be  ***
+*** read back on the machine that wrote it. Strings are interned  ***
+*** (each distinct label/op/operand text is stored once) and are  ***
+*** referenced by offset + length into the string table.          ***
+********************************************************************/
+namespace intb {
+
+const char     MAGIC[4] = {'S', 'X', 'I', 'B'};
+const uint32_t VERSION  = 2;
+
+struct Header {
+    char     magic[4];
+    uint32_t version;
+    uint32_t rowCount;
+    uint32_t stringBytes;
+    int32_t  startAddress;
+    int32_t  programLength;
+};
+
+struct StrRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Row {
+    int32_t lineNum;
+    int32_t locctr;
+    StrRef  label;
+    StrRef  opcode;
+    StrRef  operand;
+};
+
+static_assert(sizeof(Header) == 24, "intb::Header layout changed - bump VERSION");
+static_assert(sizeof(Row) == 32, "intb::Row layout changed - bump VERSION");
+
+} // namespace intb
+
+// Convert a Pass 1 row into the Line Pass 2 would parse from the .int
+bool rowToLine(IntermediateRow row, Line &out);
+
+// .intb output (Pass 1) and mmap'd input (Pass 2); false + err on failure
+bool writeIntermediateBinary(const std::string &path, const Pass1Result &result,
+                             std::string &err);
+bool writeIntermediateBinary(const std::string &path, const Pass1Sections &sections,
+                             std::string &err);
+bool loadIntermediateBinary(const std::string &path, std::vector<Line> &lines,
+                            std::string &err);
+
+// Streaming .intb input: fn sees each line in order; nothing is kept
+bool forEachIntermediateBinaryLine(const std::string &path,
+                                   const std::function<void(Line&)> &fn, std::string &err);
+
+// Debug converter: .intb back to the text .int layout
+bool readIntermediateBinaryRows(const std::string &path, Pass1Result &result,
+                                std::string &err);
@@ -22,14 +22,19 @@ bool LiteralTable::insert(const std::string& literal) {
     Literal lit;
     lit.raw = literal;
     literals[literal] = lit;
+    pending.push_back(literal);
     return true;
 }
 
-// Assign addresses and compute hex/value/length for unassigned literals
+// Assign addresses and compute hex/value/length for unassigned literals.
+// Only the pending ones are visited (in literal order, as the map would
+// give them), so each pool costs its own size, not the whole table.
 int LiteralTable::assignAddresses(int startAddress) {
     int currentAddress = startAddress;
-    for (auto &kv : literals) {
-        auto &lit = kv.second;
+    pool.clear();
+    std::sort(pending.begin(), pending.end());
+    for (const auto &name : pending) {
+        auto &lit = literals[name];
         if (lit.assigned) continue;
 
         lit.address = currentAddress;
@@ -61,8 +66,10 @@ int LiteralTable::assignAddresses(int startAddress) {
             lit.hexValue = raw;
             lit.length = 0;
         }
+        pool.emplace_back(name, lit.address);
         currentAddress += lit.length;
     }
+    pending.clear();
     return currentAddress;
 }
 
@@ -96,22 +103,22 @@ static bool parseLiteralValue(const std::string &literal,
     return false;
 }
 
-// Display literal table
-void LiteralTable::display() const {
-    using std::cout; using std::left; using std::right; using std::setw;
+// Display literal table on os (std::cout by default)
+void LiteralTable::display(std::ostream &os) const {
+    using std::left; using std::right; using std::setw;
 
     const int W_LIT  = 16;
     const int W_VAL  = 16;
     const int W_LEN  = 8;
     const int W_ADDR = 10;
 
-    cout << "\nLiteral Table\n";
-    cout << "-----------------------------------------\n";
-    cout << left  << setw(W_LIT)  << "LITERAL"
-         << right << setw(W_VAL)  << "VALUE"
-         << right << setw(W_LEN)  << "LENGTH"
-         << right << setw(W_ADDR) << "ADDRESS" << "\n";
-    cout << "-----------------------------------------\n";
+    os << "\nLiteral Table\n";
+    os << "-----------------------------------------\n";
+    os << left  << setw(W_LIT)  << "LITERAL"
+       << right << setw(W_VAL)  << "VALUE"
+       << right << setw(W_LEN)  << "LENGTH"
+       << right << setw(W_ADDR) << "ADDRESS" << "\n";
+    os << "-----------------------------------------\n";
 
     auto list = getAssignedLiterals(); // sorted by address
     for (auto &p : list) {
@@ -125,12 +132,12 @@ void LiteralTable::display() const {
         std::ostringstream addrHex;
         addrHex << std::uppercase << std::hex << std::setw(5) << std::setfill('0') << (addr & 0xFFFFF);
 
-        cout << left  << setw(W_LIT)  << lit
+        os << left  << setw(W_LIT)  << lit
              << right << setw(W_VAL)  << valueHex
              << right << setw(W_LEN)  << lengthBytes
              << right << setw(W_ADDR) << addrHex.str() << "\n";
     }
-    cout << "-----------------------------------------\n";
+    os << "-----------------------------------------\n";
 }
 
 // Get assigned literals (sorted by address)
@@ -145,6 +152,17 @@ std::vector<std::pair<std::string,int>> LiteralTable::getAssignedLiterals() cons
     return result;
 }
 
+// Get assigned literals with their byte lengths (sorted by address)
+std::vector<LiteralTable::Info> LiteralTable::getLiterals() const {
+    std::vector<Info> result;
+    for (const auto &kv : literals)
+        if (kv.second.assigned)
+            result.push_back(Info{kv.first, kv.second.length, kv.second.address});
+    std::stable_sort(result.begin(), result.end(),
+                     [](const Info &a, const Info &b) { return a.address < b.address; });
+    return result;
+}
+
 bool LiteralTable::setAddress(const std::string& literal, int addr) {
     auto it = literals.find(literal);
     if (it == literals.end()) return false;
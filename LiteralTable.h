@@ -1,15 +1,28 @@
 #pragma once
 
+#include <iostream>
 #include <string>
 #include <vector>
 #include <map>
 
 class LiteralTable {
 public:
+    // One assigned literal as exported to Pass 2
+    struct Info {
+        std::string literal;
+        int length;    // bytes
+        int address;
+    };
+
     bool insert(const std::string& literal);
+    // Places the literals not yet in a pool from startAddress on; returns
+    // the address after the pool
     int  assignAddresses(int startAddress);
+    // Literals placed by the last assignAddresses, in address order
+    const std::vector<std::pair<std::string,int>> &lastPool() const { return pool; }
     std::vector<std::pair<std::string,int>> getAssignedLiterals() const;
-    void display() const;
+    std::vector<Info> getLiterals() const;   // assigned only, sorted by address
+    void display(std::ostream &os = std::cout) const;
     bool setAddress(const std::string& literal, int addr);
 private:
     struct Literal {
@@ -20,4 +33,6 @@ private:
         bool assigned = false;
     };
     std::map<std::string, Literal> literals;
+    std::vector<std::string> pending;                 // inserted, not yet placed
+    std::vector<std::pair<std::string,int>> pool;     // placed by the last call
 };
\ No newline at end of file
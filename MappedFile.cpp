@@ -0,0 +1,85 @@
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/********************************************************************
+*** FUNCTION ~MappedFile                                          ***
+*********************************************************************
+*** DESCRIPTION : Unmaps the file if one is mapped.               ***
+********************************************************************/
+MappedFile::~MappedFile() {
+    close();
+}
+
+/********************************************************************
+*** FUNCTION open                                                 ***
+*********************************************************************
+*** DESCRIPTION : Maps the whole file read-only. Any previous     ***
+***               mapping is released first.                      ***
+*** INPUT ARGS  : path - file to map                              ***
+*** OUTPUT ARGS : err  - reason on failure                        ***
+*** RETURN      : bool - true if mapped                           ***
+********************************************************************/
+bool MappedFile::open(const std::string& path, std::string& err) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        err = "cannot stat " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    length = (size_t)st.st_size;
+    if (length == 0) {            // mmap rejects zero-length mappings
+        ::close(fd);
+        return true;
+    }
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        err = "cannot map " + path + ": " + std::strerror(errno);
+        length = 0;
+        return false;
+    }
+    bytes = static_cast<const char*>(p);
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION close                                                ***
+*********************************************************************
+*** DESCRIPTION : Releases the mapping (no-op if none).           ***
+********************************************************************/
+void MappedFile::close() {
+    if (bytes) munmap(const_cast<char*>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+}
+
+/********************************************************************
+*** FUNCTION release                                              ***
+*********************************************************************
+*** DESCRIPTION : Lets the kernel reclaim the pages of a range    ***
+***               that has already been consumed, so a front-to-  ***
+***               back walk keeps resident memory flat. The page  ***
+***               holding offset is included; a partial last page ***
+***               is kept for the next call.                      ***
+*** INPUT ARGS  : offset, len - byte range within the mapping     ***
+********************************************************************/
+void MappedFile::release(size_t offset, size_t len) const {
+    if (!bytes || offset >= length) return;
+    if (len > length - offset) len = length - offset;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = offset / page * page;
+    size_t end = (offset + len) / page * page;
+    if (end > begin)
+        madvise(const_cast<char*>(bytes) + begin, end - begin, MADV_DONTNEED);
+}
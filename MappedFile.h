@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/********************************************************************
+*** CLASS MappedFile                                              ***
+*********************************************************************
+*** DESCRIPTION : Read-only mmap of a whole file. The mapping is  ***
+***               released when the object goes out of scope.     ***
+***               Empty files open successfully with size() == 0. ***
+********************************************************************/
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& err);
+    void close();
+
+    // Drop resident pages from offset's page up to the last page ending
+    // inside [offset, offset+len); they are re-read if touched again
+    void release(size_t offset, size_t len) const;
+
+    const char* data() const { return bytes; }
+    size_t      size() const { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t      length = 0;
+};
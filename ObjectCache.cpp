@@ -0,0 +1,188 @@
+#include "ObjectCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+const char     MAGIC[4] = {'S', 'X', 'O', 'C'};
+// Bump whenever genObj's encoding changes: older caches are then ignored
+const uint32_t VERSION  = 2;
+
+// FNV-1a (a) and a second, differently seeded FNV-1a finished with a
+// splitmix64 step (b); 128 bits between them
+struct KeyBuilder {
+    uint64_t a = 1469598103934665603ull, b = 0x9E3779B97F4A7C15ull;
+
+    void bytes(const void *data, size_t n) {
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < n; ++i) {
+            a = (a ^ p[i]) * 1099511628211ull;
+            b = (b ^ p[i]) * 0x100000001B3ull + 0x2545F4914F6CDD1Dull;
+        }
+    }
+    void text(const std::string &s) { bytes(s.data(), s.size() + 1); }   // with its NUL
+    void number(int64_t v) { bytes(&v, sizeof(v)); }
+    // An absent name hashes as absent, or as external when EXTREF names it
+    void lookup(const std::map<std::string,int> &table, const std::string &name,
+                const std::set<std::string> *externals = nullptr) {
+        auto it = table.find(name);
+        if (it != table.end()) number(it->second);
+        else number(externals && externals->count(name) ? INT64_MIN + 1 : INT64_MIN);
+    }
+
+    ObjectCache::Key finish() {
+        uint64_t z = b + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        ObjectCache::Key k;
+        k.a = a;
+        k.b = z ^ (z >> 31);
+        return k;
+    }
+};
+
+// The symbol an operand names, as genObj resolves it: #/@ and ",X" removed
+std::string operandSymbol(const std::string &operand) {
+    size_t b = operand.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    std::string s = operand.substr(b);
+    if (s[0] == '#' || s[0] == '@') s.erase(0, 1);
+    size_t comma = s.find(',');
+    if (comma != std::string::npos) s.erase(comma);
+    size_t e = s.find_last_not_of(" \t");
+    return e == std::string::npos ? "" : s.substr(0, e + 1);
+}
+
+} // namespace
+
+/********************************************************************
+*** FUNCTION ObjectCache::keyFor                                  ***
+*********************************************************************
+*** DESCRIPTION : Key of one listing line's object code. Besides  ***
+***               the line's own text and LOCCTR it covers the    ***
+***               BASE value and every table value genObj could   ***
+***               read for the operand (an absent name hashes as  ***
+***               absent or external), so a changed symbol        ***
+***               invalidates exactly the lines that refer to it. ***
+*** INPUT ARGS  : L, baseReg, symaddr, litaddr                    ***
+***               externals - EXTREF names (may be null)          ***
+*** RETURN      : Key                                             ***
+********************************************************************/
+ObjectCache::Key ObjectCache::keyFor(const Line &L, int baseReg,
+                                     const std::map<std::string,int> &symaddr,
+                                     const std::map<std::string,int> &litaddr,
+                                     const std::set<std::string> *externals) {
+    KeyBuilder k;
+    k.number(VERSION);
+    k.text(L.op);
+    k.text(L.operand);
+    k.number(L.isLiteral);
+    k.number(L.locctr);
+    k.number(baseReg);
+    if (!L.operand.empty() && L.operand[0] == '=') k.lookup(litaddr, L.operand);
+    else if (L.op == "WORD") k.lookup(symaddr, symbolKey(L.operand), externals);
+    else {
+        std::string sym = operandSymbol(L.operand);
+        if (!sym.empty()) k.lookup(symaddr, symbolKey(sym), externals);
+    }
+    return k.finish();
+}
+
+/********************************************************************
+*** FUNCTION ObjectCache::load                                    ***
+*********************************************************************
+*** DESCRIPTION : Reads <base>.objcache: magic, version, count,   ***
+***               then per entry the two key halves, sizeBytes,   ***
+***               code length and code bytes.                     ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : err - reason if an existing file is unreadable  ***
+*** RETURN      : bool                                            ***
+********************************************************************/
+bool ObjectCache::load(const std::string &path, std::string &err) {
+    loaded.clear();
+    used.clear();
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return true;
+
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || memcmp(magic, MAGIC, 4) != 0 || version != VERSION) return true;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Key key;
+        Entry e;
+        uint32_t len = 0;
+        in.read(reinterpret_cast<char*>(&key.a), sizeof(key.a));
+        in.read(reinterpret_cast<char*>(&key.b), sizeof(key.b));
+        in.read(reinterpret_cast<char*>(&e.sizeBytes), sizeof(e.sizeBytes));
+        in.read(reinterpret_cast<char*>(&len), sizeof(len));
+        if (!in || len > 4096) { loaded.clear(); err = "corrupt cache " + path; return false; }
+        e.code.resize(len);
+        in.read(reinterpret_cast<char*>(e.code.data()), len);
+        if (!in) { loaded.clear(); err = "corrupt cache " + path; return false; }
+        loaded.emplace(key, std::move(e));
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION ObjectCache::save                                    ***
+*********************************************************************
+*** DESCRIPTION : Writes the entries this run used, through a     ***
+***               temporary file renamed into place. Nothing is   ***
+***               written if they equal the loaded set.           ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : err - reason on failure                         ***
+*** RETURN      : bool                                            ***
+********************************************************************/
+bool ObjectCache::save(const std::string &path, std::string &err) const {
+    if (used == loaded) return true;
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) { err = "cannot write " + tmp; return false; }
+    uint32_t count = (uint32_t)used.size();
+    out.write(MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto &kv : used) {
+        uint32_t len = (uint32_t)kv.second.code.size();
+        out.write(reinterpret_cast<const char*>(&kv.first.a), sizeof(kv.first.a));
+        out.write(reinterpret_cast<const char*>(&kv.first.b), sizeof(kv.first.b));
+        out.write(reinterpret_cast<const char*>(&kv.second.sizeBytes), sizeof(kv.second.sizeBytes));
+        out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+        out.write(reinterpret_cast<const char*>(kv.second.code.data()), len);
+    }
+    out.close();
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        err = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+void ObjectCache::nextRun() {
+    loaded.swap(used);
+    used.clear();
+    hits = misses = 0;
+}
+
+bool ObjectCache::lookup(const Key &key, Line &L, std::vector<uint8_t> &image) const {
+    auto it = loaded.find(key);
+    if (it == loaded.end()) return false;
+    L.objOffset = (int)image.size();
+    L.objLen = (int)it->second.code.size();
+    L.sizeBytes = it->second.sizeBytes;
+    image.insert(image.end(), it->second.code.begin(), it->second.code.end());
+    return true;
+}
+
+void ObjectCache::keep(const Key &key, const Line &L, const std::vector<uint8_t> &image) {
+    Entry &e = used[key];
+    e.sizeBytes = L.sizeBytes;
+    e.code.assign(image.begin() + L.objOffset, image.begin() + L.objOffset + L.objLen);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Pass2Core.h"
+
+/********************************************************************
+*** CLASS ObjectCache                                             ***
+*********************************************************************
+*** DESCRIPTION : Content-addressed object code per listing line, ***
+***               for incremental reassembly (--incremental). A   ***
+***               line's key hashes everything genObj reads: the  ***
+***               mnemonic and operand text, LOCCTR, the BASE     ***
+***               value in effect and the value of the symbol or  ***
+***               literal the operand names. A line whose key is  ***
+***               cached reuses its bytes instead of going        ***
+***               through genObj. Lines with diagnostics are      ***
+***               never cached, so their errors are always        ***
+***               reported. Saved next to the outputs as          ***
+***               <base>.objcache; only the keys the last run     ***
+***               used are kept.                                  ***
+********************************************************************/
+class ObjectCache {
+public:
+    struct Key {
+        uint64_t a = 0, b = 0;      // two independent 64-bit hashes
+        bool operator==(const Key &o) const { return a == o.a && b == o.b; }
+    };
+
+    static Key keyFor(const Line &L, int baseReg, const std::map<std::string,int> &symaddr,
+                      const std::map<std::string,int> &litaddr,
+                      const std::set<std::string> *externals = nullptr);
+
+    // A missing or stale file just starts an empty cache (false + err only
+    // for a file that exists but cannot be read)
+    bool load(const std::string &path, std::string &err);
+    // Writes the file only if this run's entries differ from what was loaded
+    bool save(const std::string &path, std::string &err) const;
+    // Makes this run's entries the ones the next run looks up (a cache kept
+    // in memory across rebuilds, as sicxe --watch does)
+    void nextRun();
+
+    // Cached code for key: bytes appended to image, L's objOffset, objLen
+    // and sizeBytes set as genObj would. Safe to call from several threads.
+    bool lookup(const Key &key, Line &L, std::vector<uint8_t> &image) const;
+    // Record that this run used key with L's code in image (hit or fresh)
+    void keep(const Key &key, const Line &L, const std::vector<uint8_t> &image);
+
+    long hits = 0, misses = 0;
+
+private:
+    struct Entry {
+        int32_t sizeBytes = 0;
+        std::vector<uint8_t> code;
+        bool operator==(const Entry &o) const { return sizeBytes == o.sizeBytes && code == o.code; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const { return (size_t)(k.a ^ (k.b >> 1)); }
+    };
+    std::unordered_map<Key, Entry, KeyHash> loaded, used;
+};
@@ -1,56 +1,136 @@
 #include "OpcodeTable.h"
-#include <algorithm>
-#include <cctype>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
-static std::string up(std::string s) {
-    for (char &c : s) c = std::toupper((unsigned char)c);
-    return s;
-}
+namespace {
 
-std::string OpcodeTable::normalize(const std::string& m) {
-    std::string s = m;
-    if (!s.empty() && s[0] == '+') s.erase(s.begin()); // strip format-4 marker
-    return up(s);
-}
+struct Mnemonic { const char* name; int opcode; int format; };
 
-OpcodeTable::OpcodeTable() {
+constexpr Mnemonic kMnemonics[] = {
     // format 3/4 (default 3; '+' selects 4)
-    table["ADD"]   = {0x18,3}; table["ADDF"] = {0x58,3}; table["AND"]  = {0x40,3};
-    table["COMP"]  = {0x28,3}; table["COMPF"]= {0x88,3};
-    table["DIV"]   = {0x24,3}; table["DIVF"] = {0x64,3};
-    table["J"]     = {0x3C,3}; table["JEQ"]  = {0x30,3}; table["JGT"]  = {0x34,3};
-    table["JLT"]   = {0x38,3}; table["JSUB"] = {0x48,3};
-    table["LDA"]   = {0x00,3}; table["LDB"]  = {0x68,3}; table["LDCH"] = {0x50,3};
-    table["LDF"]   = {0x70,3}; table["LDL"]  = {0x08,3}; table["LDS"]  = {0x6C,3};
-    table["LDT"]   = {0x74,3}; table["LDX"]  = {0x04,3}; table["LPS"]  = {0xD0,3};
-    table["MUL"]   = {0x20,3}; table["MULF"] = {0x60,3}; table["OR"]   = {0x44,3};
-    table["RD"]    = {0xD8,3}; table["RSUB"] = {0x4C,3}; table["SSK"]  = {0xEC,3};
-    table["STA"]   = {0x0C,3}; table["STB"]  = {0x78,3}; table["STCH"] = {0x54,3};
-    table["STF"]   = {0x80,3}; table["STI"]  = {0xD4,3}; table["STL"]  = {0x14,3};
-    table["STS"]   = {0x7C,3}; table["STSW"] = {0xE8,3}; table["STT"]  = {0x84,3};
-    table["STX"]   = {0x10,3}; table["SUB"]  = {0x1C,3}; table["SUBF"] = {0x5C,3};
-    table["TD"]    = {0xE0,3}; table["TIX"]  = {0x2C,3}; table["WD"]   = {0xDC,3};
+    {"ADD",   0x18,3}, {"ADDF", 0x58,3}, {"AND",  0x40,3},
+    {"COMP",  0x28,3}, {"COMPF",0x88,3},
+    {"DIV",   0x24,3}, {"DIVF", 0x64,3},
+    {"J",     0x3C,3}, {"JEQ",  0x30,3}, {"JGT",  0x34,3},
+    {"JLT",   0x38,3}, {"JSUB", 0x48,3},
+    {"LDA",   0x00,3}, {"LDB",  0x68,3}, {"LDCH", 0x50,3},
+    {"LDF",   0x70,3}, {"LDL",  0x08,3}, {"LDS",  0x6C,3},
+    {"LDT",   0x74,3}, {"LDX",  0x04,3}, {"LPS",  0xD0,3},
+    {"MUL",   0x20,3}, {"MULF", 0x60,3}, {"OR",   0x44,3},
+    {"RD",    0xD8,3}, {"RSUB", 0x4C,3}, {"SSK",  0xEC,3},
+    {"STA",   0x0C,3}, {"STB",  0x78,3}, {"STCH", 0x54,3},
+    {"STF",   0x80,3}, {"STI",  0xD4,3}, {"STL",  0x14,3},
+    {"STS",   0x7C,3}, {"STSW", 0xE8,3}, {"STT",  0x84,3},
+    {"STX",   0x10,3}, {"SUB",  0x1C,3}, {"SUBF", 0x5C,3},
+    {"TD",    0xE0,3}, {"TIX",  0x2C,3}, {"WD",   0xDC,3},
 
     // format 2
-    table["ADDR"]  = {0x90,2}; table["CLEAR"]= {0xB4,2}; table["COMPR"]= {0xA0,2};
-    table["DIVR"]  = {0x9C,2}; table["MULR"] = {0x98,2}; table["RMO"]  = {0xAC,2};
-    table["SHIFTL"]= {0xA4,2}; table["SHIFTR"]= {0xA8,2}; table["SUBR"]= {0x94,2};
-    table["SVC"]   = {0xB0,2}; table["TIXR"] = {0xB8,2};
+    {"ADDR",  0x90,2}, {"CLEAR",0xB4,2}, {"COMPR",0xA0,2},
+    {"DIVR",  0x9C,2}, {"MULR", 0x98,2}, {"RMO",  0xAC,2},
+    {"SHIFTL",0xA4,2}, {"SHIFTR",0xA8,2}, {"SUBR",0x94,2},
+    {"SVC",   0xB0,2}, {"TIXR", 0xB8,2},
 
     // format 1
-    table["FIX"]   = {0xC4,1}; table["FLOAT"]= {0xC0,1}; table["HIO"]  = {0xF4,1};
-    table["NORM"]  = {0xC8,1}; table["SIO"]  = {0xF0,1}; table["TIO"]  = {0xF8,1};
+    {"FIX",   0xC4,1}, {"FLOAT",0xC0,1}, {"HIO",  0xF4,1},
+    {"NORM",  0xC8,1}, {"SIO",  0xF0,1}, {"TIO",  0xF8,1},
+};
+constexpr size_t kCount = sizeof(kMnemonics) / sizeof(kMnemonics[0]);
+
+// Keys are the uppercased mnemonic packed into 8 bytes (all fit: max 6 chars)
+constexpr size_t kMaxKey   = 8;
+constexpr int    kSlotBits = 8;
+constexpr size_t kSlots    = size_t(1) << kSlotBits;
+
+constexpr uint64_t packName(const char* s) {
+    uint64_t key = 0;
+    for (size_t i = 0; s[i] != '\0'; ++i) key |= uint64_t((unsigned char)s[i]) << (8 * i);
+    return key;
+}
+
+constexpr unsigned slotOf(uint64_t key, uint64_t seed) {
+    return unsigned((key * seed) >> (64 - kSlotBits));
 }
 
-bool OpcodeTable::exists(const std::string& mnemonic) const {
-    return table.find(normalize(mnemonic)) != table.end();
+// splitmix64 step, used only to draw well-spread candidate seeds
+constexpr uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
 }
-int OpcodeTable::getFormat(const std::string& mnemonic) const {
+
+// Multiplicative hash: first candidate seed that gives every mnemonic its own slot
+constexpr uint64_t findSeed() {
+    uint64_t keys[kCount] = {};
+    for (size_t i = 0; i < kCount; ++i) keys[i] = packName(kMnemonics[i].name);
+    for (uint64_t k = 0; k < 4096; ++k) {
+        uint64_t seed = mix(k) | 1;
+        bool used[kSlots] = {};
+        bool ok = true;
+        for (size_t i = 0; i < kCount && ok; ++i) {
+            unsigned s = slotOf(keys[i], seed);
+            ok = !used[s];
+            used[s] = true;
+        }
+        if (ok) return seed;
+    }
+    return 0;
+}
+
+constexpr uint64_t kSeed = findSeed();
+static_assert(kSeed != 0, "no collision-free seed for the mnemonic set");
+
+struct Slot { uint64_t key; OpcodeTable::Entry entry; }; // key 0 = empty
+
+constexpr std::array<Slot, kSlots> buildSlots() {
+    std::array<Slot, kSlots> slots{};
+    for (size_t i = 0; i < kCount; ++i) {
+        uint64_t key = packName(kMnemonics[i].name);
+        Slot& s = slots[slotOf(key, kSeed)];
+        s.key = key;
+        s.entry = OpcodeTable::Entry{kMnemonics[i].opcode, kMnemonics[i].format};
+    }
+    return slots;
+}
+
+constexpr std::array<Slot, kSlots> kTable = buildSlots();
+
+// Pack a query the same way, stripping one '+' and folding case in place
+inline bool packQuery(std::string_view m, uint64_t& key) {
+    if (!m.empty() && m[0] == '+') m.remove_prefix(1); // strip format-4 marker
+    if (m.empty() || m.size() > kMaxKey) return false;
+    key = 0;
+    for (size_t i = 0; i < m.size(); ++i) {
+        unsigned char c = (unsigned char)m[i];
+        if (c == 0) return false;
+        if (c >= 'a' && c <= 'z') c = (unsigned char)(c - 'a' + 'A');
+        key |= uint64_t(c) << (8 * i);
+    }
+    return true;
+}
+
+} // namespace
+
+bool OpcodeTable::lookup(std::string_view mnemonic, Entry& out) const {
+    uint64_t key;
+    if (!packQuery(mnemonic, key)) return false;
+    const Slot& s = kTable[slotOf(key, kSeed)];
+    if (s.key != key) return false;
+    out = s.entry;
+    return true;
+}
+
+bool OpcodeTable::exists(std::string_view mnemonic) const {
+    Entry e;
+    return lookup(mnemonic, e);
+}
+int OpcodeTable::getFormat(std::string_view mnemonic) const {
     if (!mnemonic.empty() && mnemonic[0] == '+') return 4;
-    auto it = table.find(normalize(mnemonic));
-    return it == table.end() ? -1 : it->second.format;
+    Entry e;
+    return lookup(mnemonic, e) ? e.format : -1;
+}
+int OpcodeTable::getOpcode(std::string_view mnemonic) const {
+    Entry e;
+    return lookup(mnemonic, e) ? e.opcode : -1;
 }
-int OpcodeTable::getOpcode(const std::string& mnemonic) const {
-    auto it = table.find(normalize(mnemonic));
-    return it == table.end() ? -1 : it->second.opcode;
-}
\ No newline at end of file
@@ -1,18 +1,16 @@
 #pragma once
-#include <string>
-#include <map>
+#include <string_view>
 
 class OpcodeTable {
 public:
-    OpcodeTable();
+    struct Entry { int opcode; int format; }; // format: 1,2,3 (3 means 3/4)
 
-    // Query (mnemonic may be "+JSUB" for format 4)
-    bool exists(const std::string& mnemonic) const;
-    int  getFormat(const std::string& mnemonic) const; // 1,2,3 (use '+' prefix => 4)
-    int  getOpcode(const std::string& mnemonic) const; // 8-bit opcode (0x00..0xFF)
+    // The table is a compile-time perfect hash; nothing is built at runtime
+    constexpr OpcodeTable() {}
 
-private:
-    struct Entry { int opcode; int format; }; // format: 1,2,3 (3 means 3/4)
-    std::map<std::string, Entry> table;       // keys uppercased without '+'
-    static std::string normalize(const std::string& m);
-};
\ No newline at end of file
+    // Query (mnemonic may be "+JSUB" for format 4; any letter case)
+    bool lookup(std::string_view mnemonic, Entry& out) const; // one probe: opcode + format
+    bool exists(std::string_view mnemonic) const;
+    int  getFormat(std::string_view mnemonic) const; // 1,2,3 (use '+' prefix => 4)
+    int  getOpcode(std::string_view mnemonic) const; // 8-bit opcode (0x00..0xFF)
+};
@@ -0,0 +1,128 @@
+#include "OutputBuffer.h"
+#include <charconv>
+#include <cstring>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/********************************************************************
+*** FUNCTION OutputBuffer (constructor)                           ***
+*********************************************************************
+*** DESCRIPTION : Allocates the buffer (at least 64 bytes so any  ***
+***               single number fits).                            ***
+*** INPUT ARGS  : out      - stream the buffer is flushed to      ***
+***               capacity - buffer size in bytes                 ***
+********************************************************************/
+OutputBuffer::OutputBuffer(std::ostream &out, size_t capacity)
+    : out(out), buf(new char[capacity < 64 ? 64 : capacity]),
+      cap(capacity < 64 ? 64 : capacity) {}
+
+/********************************************************************
+*** FUNCTION put                                                  ***
+*********************************************************************
+*** DESCRIPTION : Appends text; text larger than the buffer is    ***
+***               written straight through after a flush.         ***
+*** INPUT ARGS  : s - text to append                              ***
+********************************************************************/
+void OutputBuffer::put(std::string_view s) {
+    if (s.size() > cap - len) {
+        flush();
+        if (s.size() >= cap) {
+            out.write(s.data(), (std::streamsize)s.size());
+            return;
+        }
+    }
+    std::memcpy(buf.get() + len, s.data(), s.size());
+    len += s.size();
+}
+
+/********************************************************************
+*** FUNCTION fill                                                 ***
+*********************************************************************
+*** DESCRIPTION : Appends count copies of c (nothing if count<=0).***
+*** INPUT ARGS  : c, count                                        ***
+********************************************************************/
+void OutputBuffer::fill(char c, int count) {
+    while (count > 0) {
+        if (len == cap) flush();
+        size_t n = cap - len < (size_t)count ? cap - len : (size_t)count;
+        std::memset(buf.get() + len, c, n);
+        len += n;
+        count -= (int)n;
+    }
+}
+
+/********************************************************************
+*** FUNCTION dec                                                  ***
+*********************************************************************
+*** DESCRIPTION : Decimal, right-aligned: pad characters go before***
+***               the sign, as with std::right.                   ***
+*** INPUT ARGS  : v, width, pad                                   ***
+********************************************************************/
+void OutputBuffer::dec(long v, int width, char pad) {
+    char digits[24];
+    char *end = std::to_chars(digits, digits + sizeof(digits), v).ptr;
+    int n = (int)(end - digits);
+    fill(pad, width - n);
+    put(std::string_view(digits, n));
+}
+
+/********************************************************************
+*** FUNCTION hex (fixed width)                                    ***
+*********************************************************************
+*** DESCRIPTION : Exactly digits uppercase hex digits, zero-      ***
+***               padded; higher bits of v are dropped.           ***
+*** INPUT ARGS  : v, digits (1..8)                                ***
+********************************************************************/
+void OutputBuffer::hex(uint32_t v, int digits) {
+    reserve(8);
+    for (int i = digits - 1; i >= 0; --i) {
+        buf[len + i] = HEX_DIGITS[v & 0xF];
+        v >>= 4;
+    }
+    len += digits;
+}
+
+/********************************************************************
+*** FUNCTION hex (unpadded)                                       ***
+*********************************************************************
+*** DESCRIPTION : Uppercase hex with no leading zeros ("0" for 0).***
+*** INPUT ARGS  : v                                               ***
+********************************************************************/
+void OutputBuffer::hex(uint32_t v) {
+    int digits = 1;
+    for (uint32_t t = v >> 4; t != 0; t >>= 4) ++digits;
+    hex(v, digits);
+}
+
+/********************************************************************
+*** FUNCTION hexBytes                                             ***
+*********************************************************************
+*** DESCRIPTION : Object code as text: two digits per byte.       ***
+*** INPUT ARGS  : bytes, count                                    ***
+********************************************************************/
+void OutputBuffer::hexBytes(const uint8_t *bytes, int count) {
+    while (count > 0) {
+        if (cap - len < 2) flush();
+        int n = (int)((cap - len) / 2);
+        if (n > count) n = count;
+        char *p = buf.get() + len;
+        for (int i = 0; i < n; ++i) {
+            p[2*i]     = HEX_DIGITS[bytes[i] >> 4];
+            p[2*i + 1] = HEX_DIGITS[bytes[i] & 0xF];
+        }
+        len += 2 * (size_t)n;
+        bytes += n; count -= n;
+    }
+}
+
+/********************************************************************
+*** FUNCTION flush                                                ***
+*********************************************************************
+*** DESCRIPTION : Hands everything buffered to the stream in one  ***
+***               write.                                          ***
+********************************************************************/
+void OutputBuffer::flush() {
+    if (len == 0) return;
+    out.write(buf.get(), (std::streamsize)len);
+    len = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+/********************************************************************
+*** CLASS OutputBuffer                                            ***
+*********************************************************************
+*** DESCRIPTION : Appends formatted output into one reusable      ***
+***               buffer and hands it to the target stream in     ***
+***               large write() calls. Numbers are formatted by   ***
+***               hand (fixed-width uppercase hex, padded         ***
+***               decimal) so rows need no iostream manipulators. ***
+***               The result is byte-for-byte what the matching   ***
+***               setw/setfill/hex chains would print. Flushed on ***
+***               destruction; flush() before touching the stream ***
+***               directly.                                       ***
+********************************************************************/
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::ostream &out, size_t capacity = 1 << 16);
+    ~OutputBuffer() { flush(); }
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void put(char c) {
+        if (len == cap) flush();
+        buf[len++] = c;
+    }
+    void put(std::string_view s);
+    void fill(char c, int count);
+
+    // s left-aligned in a field of width (setw(width) << left << s)
+    void left(std::string_view s, int width) {
+        put(s);
+        if ((int)s.size() < width) fill(' ', width - (int)s.size());
+    }
+
+    // Right-aligned decimal padded with pad to width (setw/setfill << v)
+    void dec(long v, int width = 0, char pad = ' ');
+    // Exactly digits uppercase hex digits: the low 4*digits bits of v
+    void hex(uint32_t v, int digits);
+    // Uppercase hex, no padding (uppercase << hex << v)
+    void hex(uint32_t v);
+    // Two uppercase hex digits per byte
+    void hexBytes(const uint8_t *bytes, int count);
+
+    void flush();
+
+private:
+    void reserve(size_t n) { if (cap - len < n) flush(); }
+
+    std::ostream &out;
+    std::unique_ptr<char[]> buf;
+    size_t cap;
+    size_t len = 0;
+};
@@ -0,0 +1,174 @@
+#include "OutputSink.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "MappedFile.h"
+
+/********************************************************************
+*** FUNCTION FileSink::open                                       ***
+*********************************************************************
+*** DESCRIPTION : Creates/truncates the file for writing.         ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : err - reason on failure                         ***
+*** RETURN      : bool - true if opened                           ***
+********************************************************************/
+bool FileSink::open(const std::string &p, std::string &err) {
+    path = p;
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        err = "cannot write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void FileSink::adopt(int f, const std::string &name) {
+    path = name;
+    fd = f;
+}
+
+FileSink::~FileSink() {
+    if (fd >= 0) ::close(fd);
+}
+
+/********************************************************************
+*** FUNCTION FileSink::write                                      ***
+*********************************************************************
+*** DESCRIPTION : Writes the whole block, retrying short writes.  ***
+***               The first failure is remembered for finish().   ***
+*** INPUT ARGS  : data, n                                         ***
+********************************************************************/
+void FileSink::write(const char *data, size_t n) {
+    while (n > 0 && fd >= 0 && writeErrno == 0) {
+        ssize_t w = ::write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            writeErrno = errno;
+            return;
+        }
+        data += w;
+        n -= (size_t)w;
+    }
+}
+
+/********************************************************************
+*** FUNCTION FileSink::finish                                     ***
+*********************************************************************
+*** DESCRIPTION : Closes the file.                                ***
+*** OUTPUT ARGS : err - reason if a write or the close failed     ***
+*** RETURN      : bool - true if every byte reached the file      ***
+********************************************************************/
+bool FileSink::finish(std::string &err) {
+    if (fd >= 0 && ::close(fd) != 0 && writeErrno == 0) writeErrno = errno;
+    fd = -1;
+    if (writeErrno != 0) {
+        err = "write failed for " + path + ": " + std::strerror(writeErrno);
+        return false;
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION ChangedFileSink::finish                               ***
+*********************************************************************
+*** DESCRIPTION : Compares the collected output with the file on  ***
+***               disk and writes it only if they differ (or the  ***
+***               file is missing).                               ***
+*** OUTPUT ARGS : err - reason if the file could not be written   ***
+*** RETURN      : bool - true if the file now holds the output    ***
+********************************************************************/
+bool ChangedFileSink::finish(std::string &err) {
+    MappedFile existing;
+    std::string openErr;
+    if (existing.open(path, openErr) && existing.size() == bytes.size() &&
+        (bytes.empty() || std::memcmp(existing.data(), bytes.data(), bytes.size()) == 0))
+        return true;
+    existing.close();
+
+    FileSink file;
+    if (!file.open(path, err)) return false;
+    file.write(bytes.data(), bytes.size());
+    wrote = true;
+    return file.finish(err);
+}
+
+void StdoutSink::write(const char *data, size_t n) {
+    std::cout.write(data, (std::streamsize)n);
+}
+
+bool StdoutSink::finish(std::string &err) {
+    if (!std::cout.flush()) { err = "write failed for standard output"; return false; }
+    return true;
+}
+
+void TeeSink::write(const char *data, size_t n) {
+    first.write(data, n);
+    second.write(data, n);
+}
+
+bool TeeSink::finish(std::string &err) {
+    bool a = first.finish(err);
+    std::string err2;
+    bool b = second.finish(err2);
+    if (a && !b) err = err2;
+    return a && b;
+}
+
+/********************************************************************
+*** FUNCTION SinkStream (constructor)                             ***
+*********************************************************************
+*** DESCRIPTION : Attaches the stream to its sink; a discarding   ***
+***               sink leaves the stream failed (all output is a  ***
+***               no-op).                                         ***
+*** INPUT ARGS  : sink                                            ***
+********************************************************************/
+SinkStream::SinkStream(OutputSink &sink) : std::ostream(nullptr), buf(sink) {
+    rdbuf(&buf);
+    if (sink.discards()) setstate(std::ios::badbit);
+}
+
+SinkStream::Buf::int_type SinkStream::Buf::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        char ch = traits_type::to_char_type(c);
+        sink.write(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize SinkStream::Buf::xsputn(const char *s, std::streamsize n) {
+    sink.write(s, (size_t)n);
+    return n;
+}
+
+bool isSinkKind(const std::string &kind) {
+    return kind == "file" || kind == "stdout" || kind == "memory" || kind == "null";
+}
+
+/********************************************************************
+*** FUNCTION makeSink                                             ***
+*********************************************************************
+*** DESCRIPTION : Builds the sink named by a --sink value.        ***
+*** INPUT ARGS  : kind - file, stdout, memory or null             ***
+***               path - output file (file sinks only)            ***
+***               onlyIfChanged - file sinks keep an identical    ***
+***                               file untouched                  ***
+*** OUTPUT ARGS : err  - reason on failure                        ***
+*** RETURN      : unique_ptr<OutputSink> - nullptr on failure     ***
+********************************************************************/
+std::unique_ptr<OutputSink> makeSink(const std::string &kind, const std::string &path,
+                                     std::string &err, bool onlyIfChanged) {
+    if (kind == "file" && onlyIfChanged)
+        return std::unique_ptr<OutputSink>(new ChangedFileSink(path));
+    if (kind == "file") {
+        std::unique_ptr<FileSink> file(new FileSink);
+        if (!file->open(path, err)) return nullptr;
+        return file;
+    }
+    if (kind == "stdout") return std::unique_ptr<OutputSink>(new StdoutSink);
+    if (kind == "memory") return std::unique_ptr<OutputSink>(new MemorySink);
+    if (kind == "null")   return std::unique_ptr<OutputSink>(new NullSink);
+    err = "unknown output sink '" + kind + "' (file, stdout, memory, null)";
+    return nullptr;
+}
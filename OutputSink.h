@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+/********************************************************************
+*** CLASS OutputSink                                              ***
+*********************************************************************
+*** DESCRIPTION : Destination for a text artifact (.int, listing, ***
+***               object program). Writers see it through a       ***
+***               SinkStream, so the same writer can target a     ***
+***               file, stdout, memory, nothing, or two sinks at  ***
+***               once (TeeSink - how the console echo is done    ***
+***               without re-reading the file afterwards).        ***
+********************************************************************/
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(const char *data, size_t n) = 0;
+    // Flush/close; false + err if anything written was lost
+    virtual bool finish(std::string &err) { (void)err; return true; }
+    // Where the output went, for "... written to:" messages
+    virtual std::string name() const = 0;
+    // True if everything written is thrown away (formatting can be skipped)
+    virtual bool discards() const { return false; }
+};
+
+// Regular file, written with large POSIX write() calls
+class FileSink : public OutputSink {
+public:
+    FileSink() = default;
+    ~FileSink() override;
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    bool open(const std::string &path, std::string &err);
+    // Write to an already open descriptor (e.g. --listing-fd); it is
+    // closed by finish() like an opened file
+    void adopt(int fd, const std::string &name);
+    void write(const char *data, size_t n) override;
+    bool finish(std::string &err) override;
+    std::string name() const override { return path; }
+
+private:
+    std::string path;
+    int fd = -1;
+    int writeErrno = 0;      // first write() failure, reported by finish()
+};
+
+// Regular file that is only rewritten if its contents change (--incremental),
+// so an unchanged artifact keeps its mtime and downstream steps do not fire.
+// The output is collected in memory and compared with the file at finish().
+class ChangedFileSink : public OutputSink {
+public:
+    explicit ChangedFileSink(const std::string &path) : path(path) {}
+    void write(const char *data, size_t n) override { bytes.append(data, n); }
+    bool finish(std::string &err) override;
+    std::string name() const override { return path; }
+    bool rewritten() const { return wrote; }   // after finish()
+
+private:
+    std::string path;
+    std::string bytes;
+    bool wrote = false;
+};
+
+// Standard output, through std::cout so it stays ordered with console text
+class StdoutSink : public OutputSink {
+public:
+    void write(const char *data, size_t n) override;
+    bool finish(std::string &err) override;
+    std::string name() const override { return "(stdout)"; }
+};
+
+// Kept in memory (library use, tests, benchmarks without disk I/O)
+class MemorySink : public OutputSink {
+public:
+    void write(const char *data, size_t n) override { bytes.append(data, n); }
+    std::string name() const override { return "(memory)"; }
+    const std::string &str() const { return bytes; }
+
+private:
+    std::string bytes;
+};
+
+// Discards everything
+class NullSink : public OutputSink {
+public:
+    void write(const char *, size_t) override {}
+    std::string name() const override { return "(discarded)"; }
+    bool discards() const override { return true; }
+};
+
+// Writes everything to two sinks; named after the first
+class TeeSink : public OutputSink {
+public:
+    TeeSink(OutputSink &first, OutputSink &second) : first(first), second(second) {}
+    void write(const char *data, size_t n) override;
+    bool finish(std::string &err) override;
+    std::string name() const override { return first.name(); }
+    bool discards() const override { return first.discards() && second.discards(); }
+
+private:
+    OutputSink &first, &second;
+};
+
+// Passes everything on to another sink, counting the bytes (for --trace)
+class CountingSink : public OutputSink {
+public:
+    explicit CountingSink(OutputSink &next) : next(next) {}
+    void write(const char *data, size_t n) override { count += n; next.write(data, n); }
+    bool finish(std::string &err) override { return next.finish(err); }
+    std::string name() const override { return next.name(); }
+    bool discards() const override { return next.discards(); }
+    size_t bytes() const { return count; }
+
+private:
+    OutputSink &next;
+    size_t count = 0;
+};
+
+/********************************************************************
+*** CLASS SinkStream                                              ***
+*********************************************************************
+*** DESCRIPTION : std::ostream view of a sink. Unbuffered: writers ***
+***               batch through OutputBuffer, so each write here  ***
+***               is already a large block. On a discarding sink  ***
+***               the stream starts in a failed state so iostream ***
+***               formatting is skipped too.                      ***
+********************************************************************/
+class SinkStream : public std::ostream {
+public:
+    explicit SinkStream(OutputSink &sink);
+
+private:
+    class Buf : public std::streambuf {
+    public:
+        explicit Buf(OutputSink &sink) : sink(sink) {}
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char *s, std::streamsize n) override;
+    private:
+        OutputSink &sink;
+    };
+    Buf buf;
+};
+
+// Sink kinds selectable with --sink: file (default), stdout, memory, null
+bool isSinkKind(const std::string &kind);
+// Sink of that kind; path is only used for "file", which is a ChangedFileSink
+// when onlyIfChanged. nullptr + err on failure
+std::unique_ptr<OutputSink> makeSink(const std::string &kind, const std::string &path,
+                                     std::string &err, bool onlyIfChanged = false);
@@ -0,0 +1,966 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <deque>
+#include <atomic>
+#include <future>
+#include <climits>
+#include <sstream>
+#include "Pass1Core.h"
+#include "ThreadPool.h"
+#include "RunStats.h"
+
+using namespace std;
+
+/********************************************************************
+*** FUNCTION trim                                                 ***
+*********************************************************************
+*** DESCRIPTION : Removes leading and trailing whitespace from    ***
+***               a string.                                        ***
+*** INPUT ARGS  : str - the input string to trim                  ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : string - trimmed copy of input                  ***
+********************************************************************/
+static string trim(const string& str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+/* Add numeric check used by evalEQU */
+static bool isNumber(const std::string &s) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION parseLine                                            ***
+*********************************************************************
+*** DESCRIPTION : Tokenizes a source line into label, opcode,     ***
+***               operand, and comment. Detects full-line and     ***
+***               inline comments (starting with '.'). Owning     ***
+***               copy of what lexLine returns as views.          ***
+*** INPUT ARGS  : line - raw source line string                   ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : ParsedLine - struct with fields: label, opcode, ***
+***               operand, comment, isComment                     ***
+********************************************************************/
+ParsedLine parseLine(const string& line) {
+    LexedLine lex;
+    string joinScratch, opScratch;
+    lexLine(line, lex, joinScratch);
+
+    ParsedLine parsed;
+    parsed.isComment = lex.isComment;
+    parsed.label   = string(lex.label);
+    parsed.opcode  = string(lex.opcodeUpper(opScratch));
+    parsed.operand = string(lex.operand);
+    parsed.comment = string(lex.comment);
+    return parsed;
+}
+
+/********************************************************************
+*** FUNCTION getInstructionLength                                 ***
+*********************************************************************
+*** DESCRIPTION : Computes the byte length for an instruction or  ***
+***               directive. Handles format 4 (+OP), WORD, RESW,  ***
+***               RESB, BYTE (C'..' and X'..'), and opcode table  ***
+***               formats.                                        ***
+*** INPUT ARGS  : opcode  - operation or directive string         ***
+***               operand - operand string (for BYTE/RES*)        ***
+***               optab   - reference to opcode table             ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - length in bytes; 0 if unknown             ***
+********************************************************************/
+int getInstructionLength(string_view opcode, string_view operand, const OpcodeTable& optab) {
+    string_view op = opcode;
+
+    // Check for format 4 (starts with +)
+    if (!op.empty() && op[0] == '+') {
+        return 4;
+    }
+
+    // Check directives
+    if (op == "WORD") return 3;
+    if (op == "RESW") return 3 * stoi(string(operand));
+    if (op == "RESB") return stoi(string(operand));
+    if (op == "BYTE") {
+        // C'...' or X'...'
+        if (operand.empty()) return 1;
+        if (operand[0] == 'C' || operand[0] == 'c') {
+            size_t start = operand.find('\'');
+            size_t end = operand.rfind('\'');
+            return end - start - 1;
+        } else if (operand[0] == 'X' || operand[0] == 'x') {
+            size_t start = operand.find('\'');
+            size_t end = operand.rfind('\'');
+            return (end - start - 1 + 1) / 2;
+        }
+        return 1;
+    }
+
+    // Check opcodes
+    OpcodeTable::Entry entry;
+    if (optab.lookup(op, entry)) {
+        return entry.format;
+    }
+
+    return 0;
+}
+
+/********************************************************************
+*** FUNCTION evaluateExpression                                   ***
+*********************************************************************
+*** DESCRIPTION : Parses a simple integer expression (decimal or  ***
+***               hex). Supports forms: 123, $FFFF, 0xFFFF.       ***
+*** INPUT ARGS  : expr - expression string                        ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - evaluated integer value                   ***
+********************************************************************/
+int evaluateExpression(const string& expr) {
+    string e = trim(expr);
+    if (e.empty()) return 0;
+
+    // Check for hex
+    if (e[0] == '$' || (e.length() > 2 && e[0] == '0' && (e[1] == 'x' || e[1] == 'X'))) {
+        return stoi(e.substr(e[0] == '$' ? 1 : 2), nullptr, 16);
+    }
+
+    // Decimal
+    return stoi(e);
+}
+
+/********************************************************************
+*** FUNCTION writeIntermediateHeader                              ***
+*********************************************************************
+*** DESCRIPTION : Writes the fixed header line to the .int file.  ***
+*** INPUT ARGS  : out - buffer on the open intermediate stream    ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void writeIntermediateHeader(OutputBuffer& out) {
+    out.put("LINE#  LOCCTR    LABEL      OPERATION   OPERAND\n");
+}
+
+/********************************************************************
+*** FUNCTION writeLine                                            ***
+*********************************************************************
+*** DESCRIPTION : Writes one formatted intermediate listing row.  ***
+***               Uses 2-digit LINE#, 5-hex LOCCTR, fixed columns.***
+***               The label is normalized: one trailing colon for ***
+***               symbols, "*" kept as is.                        ***
+*** INPUT ARGS  : out, row                                        ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void writeLine(OutputBuffer& out, const IntermediateRow& row) {
+    // LINE#, then LOCCTR as 5 uppercase hex
+    out.dec(row.lineNum, 2, '0');
+    out.put("     ");
+    out.hex((uint32_t)row.locctr & 0xFFFFF, 5);
+    out.put("   ");
+
+    // LABEL (normalized)
+    std::string_view lab = row.label;
+    if (lab.empty() || lab == "*") {
+        out.left(lab, 11);
+    } else {
+        if (lab.back() == ':') lab.remove_suffix(1);
+        out.put(lab);
+        out.put(':');
+        out.fill(' ', 10 - (int)lab.size());
+    }
+
+    // OPERATION and OPERAND
+    out.left(row.opcode, 12);
+    out.put(row.operand);
+    out.put('\n');
+}
+
+/********************************************************************
+*** FUNCTION writeIntermediate                                    ***
+*********************************************************************
+*** DESCRIPTION : Writes the header and every collected row of    ***
+***               the intermediate listing.                       ***
+*** INPUT ARGS  : outFile, result                                 ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void writeIntermediate(std::ostream& outFile, const Pass1Result& result) {
+    OutputBuffer out(outFile);
+    writeIntermediateHeader(out);
+    for (const auto &row : result.rows) writeLine(out, row);
+}
+
+/********************************************************************
+*** FUNCTION addRow                                               ***
+*********************************************************************
+*** DESCRIPTION : Appends one intermediate row, numbering it with ***
+***               the next output line number.                    ***
+*** INPUT ARGS  : locctr, label, opcode, operand                  ***
+*** IN/OUT ARGS : result, outLineNumber                           ***
+*** RETURN      : void                                             ***
+********************************************************************/
+static void addRow(Pass1Result &result, int &outLineNumber, int locctr,
+                   string_view label, string_view opcode, string_view operand) {
+    result.rows.emplace_back();
+    IntermediateRow &row = result.rows.back();
+    row.lineNum = ++outLineNumber;
+    row.locctr = locctr;
+    row.label.assign(label.data(), label.size());
+    row.opcode.assign(opcode.data(), opcode.size());
+    row.operand.assign(operand.data(), operand.size());
+}
+
+/* --- Add EquEval and evalEQU helper (simple evaluator) --- */
+struct EquEval { int value; bool rflag; bool ok; };
+
+static EquEval evalEQU(const std::string &expr, const SymbolTable &symtab) {
+    EquEval r; r.value = 0; r.rflag = false; r.ok = true;
+    std::string e = trim(expr);
+    if (e.empty()) { r.ok = false; return r; }
+
+    // If "*" (current location) - we can't know LOCCTR here; return 0 and mark ok
+    if (e == "*") { r.value = 0; r.rflag = false; return r; }
+
+    // If simple subtraction of two operands: A-B
+    size_t minus = e.find('-');
+    if (minus != std::string::npos) {
+        std::string a = trim(e.substr(0, minus));
+        std::string b = trim(e.substr(minus + 1));
+        int va = 0, vb = 0;
+        if (isNumber(a)) va = std::stoi(a); else va = symtab.getAddress(a);
+        if (isNumber(b)) vb = std::stoi(b); else vb = symtab.getAddress(b);
+        r.value = va - vb;
+        // rflag is relative if operand flags differ; approximate as false here
+        r.rflag = false;
+        return r;
+    }
+
+    // Single token: number or symbol
+    if (isNumber(e)) {
+        r.value = std::stoi(e);
+        r.rflag = false;
+        return r;
+    } else {
+        int addr = symtab.getAddress(e);
+        if (addr >= 0) { r.value = addr; r.rflag = true; }
+        else r.ok = false;
+        return r;
+    }
+}
+
+/* --- Define stripColon (was forward-declared) --- */
+static string_view stripColon(string_view s) {
+    if (s.empty()) return s;
+    if (s.back() == ':') return s.substr(0, s.size() - 1);
+    return s;
+}
+
+/* --- View flavour of trim for the lexer-driven main loop --- */
+static string_view trimView(string_view s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == string_view::npos) return string_view();
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+/********************************************************************
+*** STRUCT Pass1State                                             ***
+*********************************************************************
+*** DESCRIPTION : The order-dependent part of Pass 1: LOCCTR, the ***
+***               tables, output numbering and pending MFLAGs.    ***
+***               Only processLine() touches it, one line at a    ***
+***               time in source order.                           ***
+********************************************************************/
+struct Pass1State {
+    SymbolTable& symtab;
+    LiteralTable& littab;
+    const OpcodeTable& optab;
+    Pass1Result& result;
+    int LOCCTR = 0;
+    int outLineNumber = 0;
+    // pending modification flags for symbols referenced by format-4 before symbol is defined
+    std::map<std::string, bool, std::less<>> pendingMFlags;
+    bool ended = false;               // END seen
+    bool errorCheckingEnabled = true; // Set to false to disable error checking
+    std::ostream& diag;               // where errors are reported as found
+    // --stats: time spent lexing, in the symbol table and in the literal table
+    bool timed = false;
+    RunStats* stats = nullptr;        // for --trace spans of the lexing workers
+    double parseMs = 0, symbolMs = 0, literalMs = 0;
+    double* timer(double& total) { return timed ? &total : nullptr; }
+
+    Pass1State(SymbolTable& s, LiteralTable& l, const OpcodeTable& o, Pass1Result& r,
+               std::ostream& d)
+        : symtab(s), littab(l), optab(o), result(r), diag(d) {}
+};
+
+// processLine length argument: size the line here (sequential path)
+static const int kSizeHere = INT_MIN;
+
+// Keep an error as {pass 1, line, message} in the result; the caller
+// writes the same error to diag as text
+static void recordError(Pass1State& st, int lineNumber, std::string message) {
+    st.result.diagnostics.push_back(Diagnostic{1, lineNumber, std::move(message)});
+}
+
+/********************************************************************
+*** FUNCTION placeLiterals                                        ***
+*********************************************************************
+*** DESCRIPTION : Assigns addresses to the pending literals at    ***
+***               LOCCTR (LTORG, END, or the end of a control     ***
+***               section), lists them as "*" rows and updates    ***
+***               the program length.                             ***
+*** IN/OUT ARGS : st - Pass 1 state                               ***
+*** RETURN      : void                                             ***
+********************************************************************/
+static void placeLiterals(Pass1State& st) {
+    {
+        StopWatch w(st.timer(st.literalMs), "literal assignment");
+        st.LOCCTR = st.littab.assignAddresses(st.LOCCTR);
+    }
+
+    // Write the literals this pool placed (earlier pools are already listed)
+    for (const auto &lit : st.littab.lastPool()) {
+        addRow(st.result, st.outLineNumber, lit.second, "*", lit.first, "");
+    }
+
+    st.result.programLength = st.LOCCTR;
+}
+
+/********************************************************************
+*** FUNCTION processLine                                          ***
+*********************************************************************
+*** DESCRIPTION : Applies one non-comment source line to the Pass ***
+***               1 state: symbol definition, MFLAG detection,    ***
+***               START/EQU/LTORG/END handling, error checks, the ***
+***               intermediate row, and the LOCCTR advance.       ***
+*** INPUT ARGS  : lineNumber - source line number (for messages)  ***
+***               label, opcode (uppercased), operand             ***
+***               length - byte length from getInstructionLength, ***
+***                        or kSizeHere to compute it here        ***
+*** IN/OUT ARGS : st - Pass 1 state                               ***
+*** RETURN      : bool - false once END has been processed        ***
+********************************************************************/
+static bool processLine(Pass1State& st, int lineNumber, string_view label,
+                        string_view opcode, string_view operand, int length) {
+    SymbolTable& symtab = st.symtab;
+    LiteralTable& littab = st.littab;
+    Pass1Result& result = st.result;
+    int& LOCCTR = st.LOCCTR;
+    bool& hasError = result.hasError;
+    auto& pendingMFlags = st.pendingMFlags;
+
+    // Insert label into symbol table (use LOCCTR, lineNumber, hasError)
+    SymbolTable::Handle labelSym;
+    if (!label.empty()) {
+        // store symbol name internally without trailing colon
+        string_view symName = stripColon(label);
+        // Don't insert BASE directive labels
+        if (opcode != "BASE") {
+            bool inserted = false;
+            {
+                StopWatch w(st.timer(st.symbolMs), "symbol insertion");
+                labelSym = symtab.insertOrGet(symName, LOCCTR, true, true, false, &inserted);
+            }
+            if (!inserted) {
+                st.diag << "Error: Duplicate symbol '" << symName
+                          << "' on line " << lineNumber << std::endl;
+                recordError(st, lineNumber, "Duplicate symbol '" + string(symName) + "'");
+                hasError = true;
+            } else if (!pendingMFlags.empty()) {
+                // If there was a pending MFLAG for this symbol, set it now
+                auto itpf = pendingMFlags.find(symName);
+                if (itpf != pendingMFlags.end() && itpf->second) {
+                    symtab.setMFlag(labelSym, true);
+                    pendingMFlags.erase(itpf);
+                }
+            }
+        }
+    }
+
+    // NOTE: when other code references symbol names (e.g. EQU handling
+    // or any later symtab lookups), use stripColon(label) to obtain the
+    // canonical symbol name.
+
+    // Detect format-4 usage that requires modification record (MFLAG).
+    if (!opcode.empty() && opcode[0] == '+' && !operand.empty()) {
+        // ignore immediate (#), indirect (@), and literal (=) operands
+        if (operand[0] != '#' && operand[0] != '@' && operand[0] != '=') {
+            // strip indexing or trailing commas (e.g., "SYMBOL,X")
+            string_view symname = operand.substr(0, operand.find(','));
+            // trim whitespace and any trailing colon (defensive)
+            std::string name(stripColon(trimView(symname)));
+            // try to set MFLAG now; if symbol not yet present, record pending MFLAG
+            if (!symtab.setMFlag(name, true)) {
+                pendingMFlags[name] = true;
+            }
+        }
+    }
+
+    // Handle START: keep LOCCTR relative (0)
+    if (opcode == "START" && LOCCTR == 0) {
+        result.startAddress = evaluateExpression(string(operand));
+        LOCCTR = 0; // program-relative
+        addRow(result, st.outLineNumber, LOCCTR, label, opcode, operand);
+        return true;
+    }
+
+    // Handle CSECT: a control section starts over at LOCCTR 0 with its own
+    // tables. runPass1Sections gives each section a state of its own, so
+    // CSECT only ever opens one
+    if (opcode == "CSECT") {
+        addRow(result, st.outLineNumber, LOCCTR, label, opcode, operand);
+        return true;
+    }
+
+    // Handle EQU
+    if (opcode == "EQU") {
+        std::string op(trimView(operand));
+        EquEval eq;
+        if (op == "*") {
+            // current location; relocatable
+            eq.value = LOCCTR;
+            eq.rflag = true;
+            eq.ok = true;
+        } else {
+            eq = evalEQU(op, symtab);
+        }
+        // The label was entered above at LOCCTR; overwrite with the EQU result
+        if (labelSym) symtab.setEquValue(labelSym, eq.value, eq.rflag);
+        // EQU does not advance LOCCTR. In the listing, show the symbol's value
+        // (eq.value) in the LOCCTR column rather than the current LOCCTR.
+        int listingLoc = eq.ok ? eq.value : LOCCTR;
+        addRow(result, st.outLineNumber, listingLoc, label, opcode, operand);
+        return true;
+    }
+
+    // Check for literals in operand
+    if (!operand.empty() && operand[0] == '=') {
+        StopWatch w(st.timer(st.literalMs), "literal assignment");
+        littab.insert(string(operand));
+    }
+
+    // Handle END and LTORG: emit the line, then place pending literals
+    if (opcode == "END" || opcode == "LTORG") {
+        addRow(result, st.outLineNumber, LOCCTR, label, opcode, operand);
+        placeLiterals(st);
+        if (opcode == "END") st.ended = true;
+        return opcode != "END";
+    }
+
+    if (opcode == "BASE" || opcode == "NOBASE") {
+        // No address increment, but Pass 2 needs the row to track the base
+        addRow(result, st.outLineNumber, LOCCTR, label, opcode, operand);
+        return true;
+    }
+
+    // Calculate length and increment LOCCTR
+    if (st.errorCheckingEnabled && !st.optab.exists(opcode) &&
+        opcode != "WORD" && opcode != "RESW" &&
+        opcode != "RESB" && opcode != "BYTE" &&
+        opcode != "START" && opcode != "END" &&
+        opcode != "BASE" && opcode != "NOBASE" &&
+        opcode != "LTORG" && opcode != "EQU" &&
+        opcode != "EXTDEF" && opcode != "EXTREF") {
+        string msg = "Illegal instruction '" + string(opcode) + "'";
+        st.diag << "Line " << lineNumber << ": " << msg << endl;
+        recordError(st, lineNumber, msg);
+        hasError = true;
+    }
+
+    // For ordinary instructions/directives write a listing line and then advance LOCCTR
+    if (length == kSizeHere) length = getInstructionLength(opcode, operand, st.optab);
+    addRow(result, st.outLineNumber, LOCCTR, label, opcode, operand);
+    LOCCTR += length;
+    return true;
+}
+
+/********************************************************************
+*** STRUCT ScannedChunk                                           ***
+*********************************************************************
+*** DESCRIPTION : One newline-aligned slice of the source, lexed  ***
+***               and sized by a worker for the parallel path.    ***
+***               Fields are views into the source; the few that  ***
+***               had to be rewritten (lowercase opcode, joined   ***
+***               operand) live in owned. line is 1-based within  ***
+***               the chunk.                                      ***
+********************************************************************/
+struct ScannedLine {
+    int line;
+    int length;        // kSizeHere if sizing threw; redone in order
+    string_view label;
+    string_view opcode;
+    string_view operand;
+};
+
+struct ScannedChunk {
+    string_view text;
+    std::vector<ScannedLine> lines;
+    std::deque<std::string> owned;   // stable storage for rewritten fields
+    int lineCount = 0;
+};
+
+/********************************************************************
+*** FUNCTION scanChunk                                            ***
+*********************************************************************
+*** DESCRIPTION : Lexes every line of a chunk and sizes it with   ***
+***               getInstructionLength. Needs no Pass 1 state, so ***
+***               chunks are scanned concurrently.                ***
+*** INPUT ARGS  : optab - opcode table                            ***
+*** IN/OUT ARGS : chunk - text in, scanned lines out              ***
+*** RETURN      : void                                             ***
+********************************************************************/
+static void scanChunk(ScannedChunk& chunk, const OpcodeTable& optab) {
+    SourceLexer lexer;
+    lexer.attach(chunk.text);
+    LexedLine lex;
+    string opScratch;
+    auto keep = [&](string_view v) -> string_view {
+        if (v.empty() || (v.data() >= chunk.text.data() &&
+                          v.data() + v.size() <= chunk.text.data() + chunk.text.size()))
+            return v;
+        chunk.owned.emplace_back(v);
+        return chunk.owned.back();
+    };
+    while (lexer.next(lex)) {
+        if (lex.isComment) continue;
+        ScannedLine s;
+        s.line    = lexer.lineNumber();
+        s.label   = keep(lex.label);
+        s.opcode  = keep(lex.opcodeUpper(opScratch));
+        s.operand = keep(lex.operand);
+        try {
+            s.length = getInstructionLength(s.opcode, s.operand, optab);
+        } catch (...) {
+            s.length = kSizeHere;   // let the in-order step raise it where it always has
+        }
+        chunk.lines.push_back(s);
+    }
+    chunk.lineCount = lexer.lineNumber();
+}
+
+/********************************************************************
+*** FUNCTION runPass1Parallel                                     ***
+*********************************************************************
+*** DESCRIPTION : Splits the source buffer into newline-aligned   ***
+***               chunks that workers lex and size concurrently.  ***
+***               The calling thread reconciles chunks in order   ***
+***               as they complete: LOCCTR is the running sum of  ***
+***               the precomputed lengths, and symbols, EQU *,    ***
+***               LTORG/END literal placement and diagnostics go  ***
+***               through the same processLine as the sequential  ***
+***               path, so every output is identical.             ***
+*** INPUT ARGS  : text      - whole source buffer               ***
+***               firstLine - source lines before text            ***
+***               jobs      - worker threads                      ***
+*** IN/OUT ARGS : st   - Pass 1 state                             ***
+*** RETURN      : void                                             ***
+********************************************************************/
+static void runPass1Parallel(string_view text, int firstLine, Pass1State& st, int jobs) {
+    const size_t MIN_CHUNK = 64 * 1024;
+    size_t target = std::max(MIN_CHUNK, text.size() / ((size_t)jobs * 4) + 1);
+
+    std::vector<ScannedChunk> chunks;
+    for (size_t pos = 0; pos < text.size(); ) {
+        size_t end = std::min(text.size(), pos + target);
+        if (end < text.size()) {
+            size_t nl = text.find('\n', end - 1);
+            end = (nl == string_view::npos) ? text.size() : nl + 1;
+        }
+        chunks.emplace_back();
+        chunks.back().text = text.substr(pos, end - pos);
+        pos = end;
+    }
+
+    std::vector<std::promise<void>> scanned(chunks.size());
+    std::atomic<bool> stop(false);
+    ThreadPool pool(jobs);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        pool.submit([&, c] {
+            AllocPhase phase("parse (lexing workers)");
+            TraceLog::Clock::time_point t0 = TraceLog::Clock::now();
+            try {
+                if (!stop.load(std::memory_order_relaxed)) scanChunk(chunks[c], st.optab);
+            } catch (...) {
+                // Handed to the reader of this chunk, which rethrows it
+                scanned[c].set_exception(std::current_exception());
+                return;
+            }
+            if (st.stats)
+                st.stats->traceSpan("lex chunk", t0, {{"chunk", (double)c},
+                                                      {"bytes", (double)chunks[c].text.size()},
+                                                      {"lines", (double)chunks[c].lineCount}});
+            scanned[c].set_value();
+        });
+    }
+
+    int lineBase = firstLine;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        {
+            // The lexing itself runs on the pool; what shows up as parse
+            // time is how long this thread waits for it
+            StopWatch w(st.timer(st.parseMs), "parse");
+            scanned[c].get_future().get();
+        }
+        ScannedChunk& chunk = chunks[c];
+        bool more = true;
+        for (const ScannedLine& s : chunk.lines) {
+            more = processLine(st, lineBase + s.line, s.label, s.opcode, s.operand, s.length);
+            if (!more) break;
+        }
+        lineBase += chunk.lineCount;
+        ScannedChunk().lines.swap(chunk.lines);
+        chunk.owned.clear();
+        if (!more) { stop = true; break; }
+    }
+    pool.wait();
+}
+
+// --stats for one run of Pass 1 state: its parse, symbol insertion and
+// literal assignment times, the rest of totalMs as layout, and a span
+static void addPass1Times(RunStats& stats, const Pass1State& st, double totalMs,
+                          TraceLog::Clock::time_point begin, int jobs) {
+    stats.addTime("parse", st.parseMs);
+    stats.addTime("symbol insertion", st.symbolMs);
+    stats.addTime("literal assignment", st.literalMs);
+    // Everything else: LOCCTR, sizing, EQU, intermediate rows
+    stats.addTime("layout", totalMs - st.parseMs - st.symbolMs - st.literalMs);
+    // The phases above interleave per line: one span, split in its args
+    stats.traceSpan("runPass1", begin, {{"jobs", (double)jobs},
+                                        {"rows", (double)st.result.rows.size()},
+                                        {"parse_ms", st.parseMs},
+                                        {"symbol_ms", st.symbolMs},
+                                        {"literal_ms", st.literalMs}});
+}
+
+/********************************************************************
+*** FUNCTION runPass1                                             ***
+*********************************************************************
+*** DESCRIPTION : Core of SIC/XE Pass 1. Walks lexed source      ***
+***               lines (views into the source buffer), maintains ***
+***               LOCCTR, builds symbol and literal tables, and   ***
+***               collects the intermediate listing rows in       ***
+***               memory. With jobs > 1 and a large enough source ***
+***               the lexing and sizing run in parallel chunks.   ***
+*** INPUT ARGS  : source - lexer positioned at the first line      ***
+***               optab  - opcode table                           ***
+***               jobs   - worker threads (1 = sequential)        ***
+*** OUTPUT ARGS : result - intermediate rows and summary values   ***
+***               diag   - error messages, in source order        ***
+*** IN/OUT ARGS : symtab, littab - tables filled by this pass     ***
+***               stats  - phase times are added (may be null)    ***
+***               closesSection - a later CSECT ends this source: ***
+***                        place pending literals at its end      ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void runPass1(SourceLexer& source, SymbolTable& symtab, LiteralTable& littab,
+              const OpcodeTable& optab, Pass1Result& result, int jobs,
+              std::ostream& diag, RunStats* stats, bool closesSection) {
+    Pass1State st(symtab, littab, optab, result, diag);
+    st.timed = stats != nullptr;
+    st.stats = stats;
+    double totalMs = 0;
+    TraceLog::Clock::time_point begin = TraceLog::Clock::now();
+
+    {
+        StopWatch whole(st.timer(totalMs), "layout");
+        if (jobs > 1 && !source.streaming() && source.buffer().size() >= 2 * 64 * 1024) {
+            runPass1Parallel(source.buffer(), source.lineNumber(), st, jobs);
+        } else {
+            LexedLine parsed;
+            string opScratch;
+            for (;;) {
+                {
+                    StopWatch w(st.timer(st.parseMs), "parse");
+                    if (!source.next(parsed)) break;
+                }
+                // Skip comments
+                if (parsed.isComment) {
+                    continue;
+                }
+                if (!processLine(st, source.lineNumber(), parsed.label,
+                                 parsed.opcodeUpper(opScratch), parsed.operand, kSizeHere))
+                    break;
+            }
+        }
+        // A control section the next CSECT closes has no END of its own:
+        // its pending literals go at its end
+        if (closesSection && !st.ended) placeLiterals(st);
+    }
+
+    if (stats) addPass1Times(*stats, st, totalMs, begin, jobs);
+}
+
+/********************************************************************
+*** FUNCTION runPass1Streamed                                     ***
+*********************************************************************
+*** DESCRIPTION : Pass 1 over a streaming lexer, which cannot be  ***
+***               split ahead of time. Each CSECT line after some ***
+***               code closes the section being read (its pending ***
+***               literals go at its end) and opens the next, with ***
+***               its own tables and LOCCTR. Rows are numbered on ***
+***               from section to section and diagnostics written ***
+***               as found, so the output matches the split path. ***
+*** INPUT ARGS  : source - streaming lexer at the first line      ***
+***               optab  - opcode table                           ***
+*** OUTPUT ARGS : sections - one entry per control section        ***
+***               diag     - error messages, in source order      ***
+*** IN/OUT ARGS : stats - phase times (may be null)               ***
+*** RETURN      : void                                             ***
+********************************************************************/
+static void runPass1Streamed(SourceLexer& source, const OpcodeTable& optab,
+                             Pass1Sections& sections, std::ostream& diag, RunStats* stats) {
+    std::unique_ptr<Pass1State> st;
+    TraceLog::Clock::time_point begin;
+    auto open = [&] {
+        int outLineNumber = st ? st->outLineNumber : 0;
+        sections.push_back(std::make_unique<Pass1Section>());
+        Pass1Section& s = *sections.back();
+        st = std::make_unique<Pass1State>(s.symtab, s.littab, optab, s.result, diag);
+        st->timed = stats != nullptr;
+        st->stats = stats;
+        st->outLineNumber = outLineNumber;
+        begin = TraceLog::Clock::now();
+    };
+    auto close = [&] {
+        if (!stats) return;
+        double totalMs = std::chrono::duration<double, std::milli>(
+                             TraceLog::Clock::now() - begin).count();
+        addPass1Times(*stats, *st, totalMs, begin, 1);
+    };
+
+    open();
+    {
+        StopWatch whole(nullptr, "layout");
+        LexedLine parsed;
+        string opScratch;
+        for (;;) {
+            {
+                StopWatch w(st->timer(st->parseMs), "parse");
+                if (!source.next(parsed)) break;
+            }
+            if (parsed.isComment) continue;
+            string_view opcode = parsed.opcodeUpper(opScratch);
+            if (opcode == "CSECT" && !st->result.rows.empty()) {
+                placeLiterals(*st);
+                close();
+                open();
+            }
+            if (!processLine(*st, source.lineNumber(), parsed.label, opcode, parsed.operand,
+                             kSizeHere))
+                break;
+        }
+    }
+    close();
+}
+
+// Whether "csect" occurs anywhere in text, in any case: most sources
+// have no control sections and are never lexed just to look for one
+static bool mentionsCsect(string_view text) {
+    static const char WORD[] = "CSECT";
+    for (size_t i = 0; i + 5 <= text.size(); ++i) {
+        if ((text[i] & 0xDF) != 'C') continue;
+        size_t k = 1;
+        while (k < 5 && (text[i + k] & 0xDF) == WORD[k]) ++k;
+        if (k == 5) return true;
+    }
+    return false;
+}
+
+/********************************************************************
+*** FUNCTION splitSourceSections                                  ***
+*********************************************************************
+*** DESCRIPTION : Cuts a source buffer before each CSECT line that ***
+***               follows some code, so each control section can  ***
+***               be assembled on its own. A CSECT with only      ***
+***               comments ahead of it stays in the first section ***
+***               (it names that section, like START).            ***
+*** INPUT ARGS  : text - whole source buffer                      ***
+*** RETURN      : vector<SectionSource> - at least one section    ***
+********************************************************************/
+std::vector<SectionSource> splitSourceSections(string_view text) {
+    std::vector<SectionSource> parts(1);
+    parts[0].text = text;
+    if (!mentionsCsect(text)) return parts;
+
+    LexedLine lex;
+    string joinScratch, opScratch;
+    size_t start = 0;
+    int line = 0;
+    bool sawCode = false;
+    for (size_t pos = 0; pos < text.size(); ++line) {
+        size_t nl = text.find('\n', pos);
+        size_t end = (nl == string_view::npos) ? text.size() : nl;
+        lexLine(text.substr(pos, end - pos), lex, joinScratch);
+        if (!lex.isComment) {
+            if (sawCode && lex.opcodeUpper(opScratch) == "CSECT") {
+                parts.back().text = text.substr(start, pos - start);
+                parts.emplace_back();
+                parts.back().lineBase = line;
+                start = pos;
+            }
+            sawCode = true;
+        }
+        pos = (nl == string_view::npos) ? text.size() : nl + 1;
+    }
+    parts.back().text = text.substr(start);
+    return parts;
+}
+
+/********************************************************************
+*** FUNCTION runPass1Sections                                     ***
+*********************************************************************
+*** DESCRIPTION : Pass 1 for every control section of the source. ***
+***               A single section runs runPass1 on the lexer as  ***
+***               is, a streaming lexer runPass1Streamed. Several ***
+***               sections of a buffer run concurrently, each on  ***
+***               its own lexer over its slice with its own       ***
+***               tables; their diagnostics are collected and     ***
+***               written in section order, and their rows are    ***
+***               renumbered to follow on from the previous       ***
+***               section's, so the output does not depend on     ***
+***               which section finished first.                   ***
+*** INPUT ARGS  : source - lexer positioned at the first line      ***
+***               optab  - opcode table                           ***
+***               jobs   - worker threads                         ***
+*** OUTPUT ARGS : sections - one entry per control section        ***
+***               diag     - error messages, in source order      ***
+*** IN/OUT ARGS : stats - phase times (may be null)               ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void runPass1Sections(SourceLexer& source, const OpcodeTable& optab, Pass1Sections& sections,
+                      int jobs, std::ostream& diag, RunStats* stats) {
+    sections.clear();
+    if (source.streaming()) {
+        runPass1Streamed(source, optab, sections, diag, stats);
+        return;
+    }
+    std::vector<SectionSource> parts = splitSourceSections(source.buffer());
+    if (parts.size() <= 1) {
+        sections.push_back(std::make_unique<Pass1Section>());
+        Pass1Section& only = *sections.back();
+        runPass1(source, only.symtab, only.littab, optab, only.result, jobs, diag, stats);
+        return;
+    }
+
+    for (size_t k = 0; k < parts.size(); ++k) sections.push_back(std::make_unique<Pass1Section>());
+    std::vector<std::ostringstream> diags(parts.size());
+    // Each section is timed on its own and the phases summed afterwards
+    std::vector<std::unique_ptr<RunStats>> sectionStats(parts.size());
+    if (stats)
+        for (auto& ss : sectionStats) ss = std::make_unique<RunStats>("pass1", "");
+    {
+        StopWatch whole(nullptr, "layout");
+        ThreadPool pool(std::max(1, std::min(jobs, (int)parts.size())));
+        pool.parallelFor(parts.size(), [&](size_t k) {
+            TraceLog::Clock::time_point t0 = TraceLog::Clock::now();
+            SourceLexer lexer;
+            lexer.attach(parts[k].text, parts[k].lineBase);
+            Pass1Section& s = *sections[k];
+            runPass1(lexer, s.symtab, s.littab, optab, s.result, 1, diags[k],
+                     sectionStats[k].get(), k + 1 < parts.size());
+            if (stats)
+                stats->traceSpan("control section", t0, {{"section", (double)k},
+                                                         {"rows", (double)s.result.rows.size()}});
+        });
+    }
+
+    int rowBase = 0;
+    for (size_t k = 0; k < sections.size(); ++k) {
+        diag << diags[k].str();
+        std::vector<IntermediateRow>& rows = sections[k]->result.rows;
+        for (auto& row : rows) row.lineNum += rowBase;
+        if (!rows.empty()) rowBase = rows.back().lineNum;
+    }
+    if (stats)
+        for (const auto& ss : sectionStats) stats->addTimes(*ss);
+}
+
+bool hasErrors(const Pass1Sections& sections) {
+    for (const auto& s : sections)
+        if (s->result.hasError) return true;
+    return false;
+}
+
+void writeIntermediate(std::ostream& outFile, const Pass1Sections& sections) {
+    OutputBuffer out(outFile);
+    writeIntermediateHeader(out);
+    for (const auto& s : sections)
+        for (const auto &row : s->result.rows) writeLine(out, row);
+}
+
+// Name, start, length and tables of one program or control section
+static void printSectionSummary(const string& name, const Pass1Result& result,
+                                const SymbolTable& symtab, const LiteralTable& littab,
+                                std::ostream& os) {
+    os << "\nProgram Name: " << name << endl;
+    os << "Start Address: " << hex << uppercase << result.startAddress << endl;
+    os << "Program Length: " << result.programLength << dec << " bytes" << endl;
+
+    // Display tables
+    symtab.display(os);
+    littab.display(os);
+}
+
+// Error status line and the end-of-pass banner
+static void printPass1Status(bool hasError, std::ostream& os) {
+    if (hasError) {
+        os << "\n*** ERRORS DETECTED - See messages above ***" << endl;
+    } else {
+        os << "\n*** No errors detected ***" << endl;
+    }
+
+    os << "\n========== PASS 1 COMPLETE ==========" << endl;
+}
+
+/********************************************************************
+*** FUNCTION printPass1Summary                                    ***
+*********************************************************************
+*** DESCRIPTION : Prints program name, start address, length, the ***
+***               symbol and literal tables, and the error status ***
+***               line that close out a Pass 1 run.               ***
+*** INPUT ARGS  : result - Pass 1 rows and summary values         ***
+***               symtab, littab - the program's tables           ***
+***               os - console stream                             ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void printPass1Summary(const Pass1Result& result, const SymbolTable& symtab,
+                       const LiteralTable& littab, std::ostream& os) {
+    printSectionSummary(result.programName, result, symtab, littab, os);
+    printPass1Status(result.hasError, os);
+}
+
+/********************************************************************
+*** FUNCTION printPass1Summary                                    ***
+*********************************************************************
+*** DESCRIPTION : Same, for a source split into control sections: ***
+***               each section's name, start, length and tables   ***
+***               in source order, then one error status line.    ***
+*** INPUT ARGS  : sections - Pass 1 output, one per section       ***
+***               os - console stream                             ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void printPass1Summary(const Pass1Sections& sections, std::ostream& os) {
+    if (sections.size() == 1) {
+        const Pass1Section& only = *sections.front();
+        printPass1Summary(only.result, only.symtab, only.littab, os);
+        return;
+    }
+    // Each control section is named by the label on its START/CSECT row
+    for (const auto& s : sections) {
+        const std::vector<IntermediateRow>& rows = s->result.rows;
+        string name = rows.empty() ? string() : string(stripColon(rows.front().label));
+        printSectionSummary(name, s->result, s->symtab, s->littab, os);
+    }
+    printPass1Status(hasErrors(sections), os);
+}
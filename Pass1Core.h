@@ -0,0 +1,127 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SymbolTable.h"
+#include "LiteralTable.h"
+#include "OpcodeTable.h"
+#include "SourceLexer.h"
+#include "OutputBuffer.h"
+#include "Diagnostic.h"
+
+/********************************************************************
+*** STRUCT ParsedLine                                             ***
+*********************************************************************
+*** DESCRIPTION : Holds the parsed components of a source line:   ***
+***               label, opcode, operand, comment. isComment=true ***
+***               for full-line comments starting with '.'.       ***
+********************************************************************/
+struct ParsedLine {
+    std::string label;
+    std::string opcode;
+    std::string operand;
+    std::string comment;
+    bool isComment;
+};
+
+/********************************************************************
+*** STRUCT IntermediateRow                                        ***
+*********************************************************************
+*** DESCRIPTION : One row of the intermediate listing as Pass 1   ***
+***               would write it to the .int file: LINE#, LOCCTR, ***
+***               LABEL, OPERATION, OPERAND. Literal rows use the ***
+***               label "*" and carry the literal as the opcode.  ***
+********************************************************************/
+struct IntermediateRow {
+    int lineNum;
+    int locctr;
+    std::string label;
+    std::string opcode;
+    std::string operand;
+};
+
+/********************************************************************
+*** STRUCT Pass1Result                                            ***
+*********************************************************************
+*** DESCRIPTION : Everything Pass 1 produces besides the symbol   ***
+***               and literal tables: the intermediate rows in    ***
+***               output order, program-level summary values and  ***
+***               each error as it was raised.                    ***
+********************************************************************/
+struct Pass1Result {
+    std::vector<IntermediateRow> rows;
+    std::vector<Diagnostic> diagnostics;     // in source order, as written to diag
+    std::string programName;
+    int startAddress = 0;
+    int programLength = 0;
+    bool hasError = false;
+};
+
+ParsedLine parseLine(const std::string& line);
+int  getInstructionLength(std::string_view opcode, std::string_view operand,
+                          const OpcodeTable& optab);
+int  evaluateExpression(const std::string& expr);
+
+class RunStats;
+
+// Run Pass 1 over lexed source lines; errors are reported on diag as found.
+// jobs > 1 lexes and sizes chunks of the source in parallel (same output);
+// the lexer must then still be at the start of its buffer (a streaming
+// lexer is always read in order). With stats, the parse, symbol insertion
+// and literal assignment times are added to it. closesSection: the source
+// is a control section the next CSECT ends, so literals still pending
+// when it runs out are placed there and set its length (without END a
+// lone program leaves them unplaced).
+void runPass1(SourceLexer& source, SymbolTable& symtab, LiteralTable& littab,
+              const OpcodeTable& optab, Pass1Result& result, int jobs = 1,
+              std::ostream& diag = std::cerr, RunStats* stats = nullptr,
+              bool closesSection = false);
+
+/********************************************************************
+*** STRUCT Pass1Section                                           ***
+*********************************************************************
+*** DESCRIPTION : Pass 1 output of one control section: its own   ***
+***               symbol and literal tables and its rows. A       ***
+***               source without CSECT is a single section.       ***
+********************************************************************/
+struct Pass1Section {
+    SymbolTable symtab;
+    LiteralTable littab;
+    Pass1Result result;
+};
+typedef std::vector<std::unique_ptr<Pass1Section>> Pass1Sections;
+
+// One control section of a source buffer: its text (from its CSECT line,
+// or the start of the source, up to the next CSECT line) and the number
+// of source lines before it
+struct SectionSource {
+    std::string_view text;
+    int lineBase = 0;
+};
+std::vector<SectionSource> splitSourceSections(std::string_view text);
+
+// Pass 1 per control section, each with its own LOCCTR and tables. One
+// section is just runPass1 (with jobs); several are assembled
+// concurrently on up to jobs threads, their rows numbered on from one
+// section to the next and their diagnostics written in source order.
+// A streaming lexer is read once, in order, starting a new section at
+// each CSECT line.
+void runPass1Sections(SourceLexer& source, const OpcodeTable& optab, Pass1Sections& sections,
+                      int jobs = 1, std::ostream& diag = std::cerr, RunStats* stats = nullptr);
+bool hasErrors(const Pass1Sections& sections);
+
+// Text .int output (same layout the standalone Pass1 has always written)
+void writeIntermediateHeader(OutputBuffer& out);
+void writeLine(OutputBuffer& out, const IntermediateRow& row);
+void writeIntermediate(std::ostream& outFile, const Pass1Result& result);
+void writeIntermediate(std::ostream& outFile, const Pass1Sections& sections);
+
+// Console summary printed after Pass 1 (name, start, length, tables, status)
+void printPass1Summary(const Pass1Result& result, const SymbolTable& symtab,
+                       const LiteralTable& littab, std::ostream& os = std::cout);
+// Every section's name, start, length and tables, then the status
+void printPass1Summary(const Pass1Sections& sections, std::ostream& os = std::cout);
@@ -0,0 +1,1284 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
+#include <cstdio>
+#include "Pass2Core.h"
+#include "RunStats.h"
+#include "ThreadPool.h"
+#include "ObjectCache.h"
+#include "OutputBuffer.h"
+#include "OutputSink.h"
+
+using namespace std;
+
+static string trim(const string &s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+static std::string_view trimView(std::string_view s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string_view::npos) return std::string_view();
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+static string upper(string s){ for(char &c:s) c = toupper((unsigned char)c); return s; }
+static bool isDigits(const string &s){ if(s.empty()) return false; for(char c:s) if(!isdigit((unsigned char)c)) return false; return true; }
+
+/********************************************************************
+*** FUNCTION symbolKey
+*********************************************************************
+*** DESCRIPTION : Key under which a symbol is looked up in symaddr:
+***               trimmed, colon stripped, uppercased and cut to the
+***               6 characters SymbolTable keeps.
+*** INPUT ARGS : name - symbol as written in an operand or table
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : none
+*** RETURN : string - lookup key
+********************************************************************/
+std::string symbolKey(std::string_view name) {
+    string key = upper(trim(string(name)));
+    if (!key.empty() && key.back() == ':') key.pop_back();
+    if (key.size() > 6) key.resize(6);
+    return key;
+}
+
+// Register numbers (SIC/XE)
+static int regNum(string r) {
+    r = upper(trim(r));
+    if (r == "A")  return 0;
+    if (r == "X")  return 1;
+    if (r == "L")  return 2;
+    if (r == "B")  return 3;
+    if (r == "S")  return 4;
+    if (r == "T")  return 5;
+    if (r == "F")  return 6;
+    if (r == "PC") return 8;
+    if (r == "SW") return 9;
+    return -1;
+}
+
+// Parse a listing line from .int
+bool parseListing(const string &raw, Line &out) {
+    string s = trim(raw);
+    if (s.empty()) return false;
+    if (s.rfind("LINE#", 0) == 0) return false;
+
+    istringstream iss(s);
+    string lnTok, locTok, t1;
+    if (!(iss >> lnTok)) return false;
+    if (!isDigits(lnTok)) return false;
+    if (!(iss >> locTok)) return false;
+    if (!(iss >> t1)) return false;
+
+    string label, op;
+    if (!t1.empty() && (t1 == "*" || t1.back() == ':')) {
+        label = t1;
+        if (!(iss >> op)) op.clear();
+    } else {
+        op = t1;
+    }
+
+    string rest; getline(iss, rest);
+    out.lineNum = stoi(lnTok);
+    out.locctr  = stoi(locTok, nullptr, 16);
+    out.label   = label;
+    out.op      = upper(op);
+    out.operand = trim(rest);
+    out.isLiteral = (label == "*");
+    return !out.op.empty();
+}
+
+/********************************************************************
+*** FUNCTION constantBytes
+*********************************************************************
+*** DESCRIPTION : Append the bytes of a C'...' or X'...' constant
+***               (BYTE operand, or a literal without its '=') to the
+***               object image. X constants must be an even number of
+***               hex digits.
+*** INPUT ARGS : text - constant as written
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : image - bytes appended on success, untouched on failure
+*** RETURN : bool - false if the constant is malformed
+********************************************************************/
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = (char)toupper((unsigned char)c);
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool constantBytes(std::string_view text, std::vector<uint8_t> &image) {
+    if (text.size() < 3) return false;
+    char kind = (char)toupper((unsigned char)text[0]);
+    size_t first = text.find('\'');
+    size_t last  = text.rfind('\'');
+    if (first == std::string_view::npos || last <= first) return false;
+    std::string_view body = text.substr(first + 1, last - first - 1);
+    if (kind == 'C') {
+        image.insert(image.end(), body.begin(), body.end());
+        return true;
+    }
+    if (kind == 'X') {
+        if (body.size() % 2 != 0) return false;
+        size_t start = image.size();
+        for (size_t i = 0; i < body.size(); i += 2) {
+            int hi = hexDigit(body[i]), lo = hexDigit(body[i + 1]);
+            if (hi < 0 || lo < 0) { image.resize(start); return false; }
+            image.push_back((uint8_t)((hi << 4) | lo));
+        }
+        return true;
+    }
+    return false;
+}
+
+/********************************************************************
+*** FUNCTION declaredLength
+*********************************************************************
+*** DESCRIPTION : Bytes a C'...'/X'...' constant occupies in the
+***               layout Pass 1 assigned, even if it is malformed.
+*** INPUT ARGS : text - constant as written
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : none
+*** RETURN : int - byte length (0 if not a C/X constant)
+********************************************************************/
+static int declaredLength(std::string_view text) {
+    if (text.size() < 3) return 0;
+    char kind = (char)toupper((unsigned char)text[0]);
+    size_t first = text.find('\'');
+    size_t last  = text.rfind('\'');
+    if (first == std::string_view::npos || last <= first) return 0;
+    size_t n = last - first - 1;
+    if (kind == 'C') return (int)n;
+    if (kind == 'X') return (int)((n + 1) / 2);
+    return 0;
+}
+
+static bool isNumber(std::string_view s) {
+    if (s.empty()) return false;
+    size_t i = 0;
+    if (s[0]=='+'||s[0]=='-') i=1;
+    for (; i<s.size(); ++i) if (!isdigit((unsigned char)s[i])) return false;
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION addErr
+*********************************************************************
+*** DESCRIPTION : Record an error as {pass 2, line, message} in an
+***               error list (the program's, or a per-chunk list that
+***               is merged into it in line order). Printed, it reads
+***               "Line <n>: <msg>" if lineNum > 0.
+*** INPUT ARGS : lineNum  - source line number (or <=0 for none)
+***              msg      - human-readable error message
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : errs - error list to append to
+*** RETURN : void
+********************************************************************/
+
+static void addErr(std::vector<Diagnostic> &errs, int lineNum, const std::string &msg) {
+    errs.push_back(Diagnostic{2, lineNum, msg});
+}
+
+/********************************************************************
+*** FUNCTION splitCSV
+*********************************************************************
+*** DESCRIPTION : Split a comma-separated operand list (e.g., for
+***               EXTDEF/EXTREF) into trimmed, uppercased tokens.
+*** INPUT ARGS : s - raw comma-separated string
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : none
+*** RETURN : std::vector<std::string> - tokens in order
+********************************************************************/
+static std::vector<std::string> splitCSV(const std::string& s) {
+    std::vector<std::string> out; std::string cur;
+    for(char c: s){
+        if(c==','){ std::string t=trim(cur); if(!t.empty()) out.push_back(upper(t)); cur.clear(); }
+        else cur.push_back(c);
+    }
+    std::string t=trim(cur); if(!t.empty()) out.push_back(upper(t));
+    return out;
+}
+
+// EXTREF operand: names in order for the R record, and their keys
+static void addExtrefs(Pass2Program &prog, const std::string &operand) {
+    for (auto &name : splitCSV(operand)) {
+        prog.externals.insert(symbolKey(name));
+        prog.extrefs.push_back(std::move(name));
+    }
+}
+
+/********************************************************************
+*** FUNCTION noteModification
+*********************************************************************
+*** DESCRIPTION : Record the M record an assembled line needs, if
+***               any. Only format 4 address fields and WORD values
+***               are absolute addresses in the object code: they
+***               need one when they name a relocatable symbol (RFLAG
+***               set, or a literal) or an EXTREF symbol. Format 3
+***               PC/BASE-relative displacements, immediate numbers
+***               and absolute EQU symbols load as they are.
+*** INPUT ARGS : L - line after genObj (no code: nothing to patch)
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : prog - modifications appended
+*** RETURN : void
+********************************************************************/
+static void noteModification(const Line &L, Pass2Program &prog) {
+    if (L.objLen == 0) return;
+    bool fmt4 = !L.op.empty() && L.op[0]=='+';
+    if (!fmt4 && L.op != "WORD") return;
+    Modification m;
+    m.address = fmt4 ? L.locctr + 1 : L.locctr;     // format 4: after the opcode/nixbpe byte
+    m.halfBytes = fmt4 ? 5 : 6;
+    std::string_view targ = trimView(L.operand);
+    if (fmt4) {
+        if (!L.operand.empty() && L.operand[0]=='=') { prog.modifications.push_back(m); return; }
+        if (!targ.empty() && (targ[0]=='#' || targ[0]=='@')) targ.remove_prefix(1);
+        targ = trimView(targ.substr(0, targ.find(',')));
+    }
+    if (targ.empty() || isNumber(targ)) return;
+    std::string key = symbolKey(targ);
+    if (prog.symaddr.count(key)) {
+        if (!prog.absolutes.count(key)) prog.modifications.push_back(m);
+    } else if (prog.externals.count(key)) {
+        // name it as the R record does, whatever the operand's spelling
+        for (const auto &name : prog.extrefs)
+            if (symbolKey(name) == key) { m.symbol = name; break; }
+        prog.modifications.push_back(std::move(m));
+    }
+}
+
+/********************************************************************
+*** FUNCTION printErrorCategorySummary
+*********************************************************************
+*** DESCRIPTION : Print a one-line categorized error summary counting
+***               common error types collected during Pass 2.
+*** INPUT ARGS : errors - Pass 2 errors in report order
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : os - console stream
+*** RETURN : void
+********************************************************************/
+static void printErrorCategorySummary(const std::vector<Diagnostic> &errors, std::ostream &os) {
+    int undef=0, illegal=0, range=0, unknown=0, badreg=0;
+    for (auto &d : errors) {
+        const std::string &e = d.message;
+        if (e.find("Undefined symbol") != std::string::npos) ++undef;
+        else if (e.find("Illegal") != std::string::npos) ++illegal;
+        else if (e.find("out of range") != std::string::npos) ++range;
+        else if (e.find("Unknown mnemonic") != std::string::npos) ++unknown;
+        else if (e.find("register") != std::string::npos) ++badreg;
+    }
+    if (!errors.empty()) {
+        os << "\nError summary: "
+           << "undefined=" << undef << ", illegal=" << illegal
+           << ", out_of_range=" << range << ", unknown_mnemonic=" << unknown
+           << ", bad_register=" << badreg << "\n";
+    }
+}
+
+/********************************************************************
+*** TEMPLATE encodeInstr
+*********************************************************************
+*** DESCRIPTION : Append one instruction to the object image. The
+***               byte layout is fixed per format at compile time:
+***               1: opcode
+***               2: opcode | r1 r2
+***               3: opcode+ni | xbpe disp(12)
+***               4: opcode+ni | xbpe address(20)
+*** INPUT ARGS : first - first byte (opcode, with n/i for formats 3/4)
+***              flags - r1 (format 2) or xbpe (formats 3/4)
+***              field - r2 (format 2), displacement or address
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : image - program object bytes
+*** RETURN : int - number of bytes appended (the format number)
+********************************************************************/
+template <int Format>
+static inline int encodeInstr(std::vector<uint8_t> &image, int first, int flags, int field) {
+    static_assert(Format >= 1 && Format <= 4, "SIC/XE instruction formats are 1-4");
+    uint8_t b[Format];
+    b[0] = (uint8_t)first;
+    if constexpr (Format == 2) {
+        b[1] = (uint8_t)(((flags & 0xF) << 4) | (field & 0xF));
+    } else if constexpr (Format == 3) {
+        b[1] = (uint8_t)((flags << 4) | ((field >> 8) & 0xF));
+        b[2] = (uint8_t)(field & 0xFF);
+    } else if constexpr (Format == 4) {
+        b[1] = (uint8_t)((flags << 4) | ((field >> 16) & 0xF));
+        b[2] = (uint8_t)((field >> 8) & 0xFF);
+        b[3] = (uint8_t)(field & 0xFF);
+    }
+    image.insert(image.end(), b, b + Format);
+    return Format;
+}
+
+/********************************************************************
+*** FUNCTION genObj
+*********************************************************************
+*** DESCRIPTION : Generate object code for one assembled line. Handles:
+***               - Directives: WORD/BYTE/RESW/RESB/Literals
+***               - Formats 1/2/3/4 (uses OpcodeTable)
+***               - Addressing modes: immediate(@/#), indirect, indexed
+***               - PC-relative and BASE-relative displacement selection
+***               - Format 4 absolute target handling
+***               Object bytes are appended to the program image and
+***               the line records where its bytes start and how many.
+*** INPUT ARGS : symaddr - symbol table (LABEL -> address)
+***              litaddr - literal table (token -> address)
+***              optab   - opcode/format lookup
+***              baseReg - BASE register value, or -1 if inactive
+***              externals - EXTREF names (symbolKey), may be null
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : L     - line to annotate with obj bytes and sizeBytes
+***               image - program object bytes
+***               errs  - error list for this line's diagnostics
+*** RETURN : void
+********************************************************************/
+void genObj(Line &L,
+            const std::map<std::string,int> &symaddr,
+            const std::map<std::string,int> &litaddr,
+            const OpcodeTable& optab,
+            int baseReg,
+            std::vector<uint8_t> &image,
+            std::vector<Diagnostic> &errs,
+            const std::set<std::string> *externals)
+{
+    L.objOffset = (int)image.size(); L.objLen = 0; L.sizeBytes = 0;
+    if (L.op=="START"||L.op=="END"||L.op=="EQU"||L.op=="BASE"||L.op=="NOBASE"||
+        L.op=="LTORG"||L.op=="EXTDEF"||L.op=="EXTREF"||L.op=="CSECT") return;
+    if (L.op=="RESW"){ L.sizeBytes = (isNumber(L.operand)? stoi(L.operand)*3:0); return; }
+    if (L.op=="RESB"){ L.sizeBytes = (isNumber(L.operand)? stoi(L.operand):0);  return; }
+    if (L.op=="WORD"){
+        int v=0;
+        if(isNumber(L.operand)) v=stoi(L.operand);
+        else {
+            auto it=symaddr.find(symbolKey(L.operand));
+            if(it!=symaddr.end()) v=it->second;
+            else if(!(externals && externals->count(symbolKey(L.operand))))
+                addErr(errs,L.lineNum,"Undefined symbol in WORD: "+L.operand);
+        }
+        const uint8_t w[3] = { (uint8_t)((v>>16)&0xFF), (uint8_t)((v>>8)&0xFF), (uint8_t)(v&0xFF) };
+        image.insert(image.end(), w, w + 3);
+        L.objLen=L.sizeBytes=3; return;
+    }
+    if (L.op=="BYTE"){
+        if(constantBytes(L.operand,image)) L.objLen=L.sizeBytes=(int)image.size()-L.objOffset;
+        else { L.sizeBytes=declaredLength(L.operand); addErr(errs,L.lineNum,"Invalid BYTE operand: "+L.operand); }
+        return;
+    }
+    if (L.isLiteral){
+        if(L.op.size()>=4 && L.op[0]=='=' && constantBytes(std::string_view(L.op).substr(1),image))
+            L.objLen=L.sizeBytes=(int)image.size()-L.objOffset;
+        else {
+            if(!L.op.empty() && L.op[0]=='=') L.sizeBytes=declaredLength(std::string_view(L.op).substr(1));
+            addErr(errs,L.lineNum,"Invalid literal: "+L.op);
+        }
+        return;
+    }
+    bool fmt4 = (!L.op.empty() && L.op[0]=='+');
+    std::string_view baseOp = fmt4? std::string_view(L.op).substr(1): std::string_view(L.op);
+    OpcodeTable::Entry ent;
+    if(!optab.lookup(baseOp, ent)){ addErr(errs,L.lineNum,"Unknown mnemonic: "+std::string(baseOp)); return; }
+    int fmt = fmt4?4:ent.format;
+    int opcode = ent.opcode;
+
+    if(fmt==1){
+        L.objLen=L.sizeBytes=encodeInstr<1>(image,opcode,0,0); return;
+    }
+    if(fmt==2){
+        int r1=-1,r2=0;
+        size_t c=L.operand.find(',');
+        if(c==std::string::npos) r1=regNum(L.operand);
+        else { r1=regNum(L.operand.substr(0,c)); r2=regNum(L.operand.substr(c+1)); }
+        if(r1<0||r2<0){ addErr(errs,L.lineNum,"Invalid register in format 2: "+L.operand); return; }
+        L.objLen=L.sizeBytes=encodeInstr<2>(image,opcode,r1,r2); return;
+    }
+
+    bool immediate=false, indirect=false, indexed=false;
+    std::string_view targ=trimView(L.operand);
+    if(!targ.empty()&&targ[0]=='#'){ immediate=true; targ.remove_prefix(1); }
+    else if(!targ.empty()&&targ[0]=='@'){ indirect=true; targ.remove_prefix(1); }
+    size_t comma=targ.find(',');
+    if(comma!=std::string_view::npos){
+        std::string_view r=trimView(targ.substr(comma+1));
+        if(r.size()==1 && toupper((unsigned char)r[0])=='X') indexed=true;
+        targ=trimView(targ.substr(0,comma));
+    }
+    bool immNumber = immediate && isNumber(targ);
+    int targetAddr=0; bool targetKnown=false;
+    if(!L.operand.empty() && L.operand[0]=='='){
+        auto litIt=litaddr.find(L.operand);
+        if(litIt!=litaddr.end()){ targetAddr=litIt->second; targetKnown=true; }
+        else addErr(errs,L.lineNum,"Literal not found: "+L.operand);
+    } else if(immNumber){
+        targetAddr=stoi(std::string(targ)); targetKnown=true;
+    } else if(!targ.empty()){
+        auto si=symaddr.find(symbolKey(targ));
+        if(si!=symaddr.end()){ targetAddr=si->second; targetKnown=true; }
+        else if(externals && externals->count(symbolKey(targ))){
+            // Another control section's symbol: its address is only known
+            // at load time, which needs a 20-bit format 4 field
+            if(fmt4) targetKnown=true;
+            else addErr(errs,L.lineNum,"External symbol needs format 4: "+std::string(targ));
+        }
+        else addErr(errs,L.lineNum,"Undefined symbol: "+std::string(targ));
+    }
+    int nBit,iBit;
+    if(immNumber){ nBit=0; iBit=1; }
+    else if(immediate && !indirect){ nBit=1; iBit=1; }
+    else if(indirect && !immediate){ nBit=1; iBit=0; }
+    else { nBit=1; iBit=1; }
+    int xbpe=0; if(indexed) xbpe|=0x8;
+    int first=(opcode & 0xFC) | ((nBit<<1)|iBit);
+
+    if(fmt==4){
+        if(!targetKnown){ addErr(errs,L.lineNum,"Format 4 operand unknown: "+L.operand); return; }
+        xbpe|=0x1;
+        L.objLen=L.sizeBytes=encodeInstr<4>(image,first,xbpe,targetAddr & 0xFFFFF); return;
+    }
+
+    int disp=0;
+    if(immNumber){
+        disp = targetAddr & 0xFFF;
+    } else if(targetKnown){
+        int pc = L.locctr + 3;
+        int d  = targetAddr - pc;
+        if(d >= -2048 && d <= 2047){
+            xbpe |= 0x2; disp = d & 0xFFF;
+        } else if(baseReg >=0){
+            int bdisp = targetAddr - baseReg;
+            if(bdisp >=0 && bdisp <= 4095){ xbpe|=0x4; disp=bdisp & 0xFFF; }
+            else { addErr(errs,L.lineNum,"Address out of range (PC/BASE): "+L.operand); return; }
+        } else {
+            addErr(errs,L.lineNum,"Address out of range (PC) and no BASE set: "+L.operand); return;
+        }
+    }
+    L.objLen=L.sizeBytes=encodeInstr<3>(image,first,xbpe,disp);
+}
+
+/********************************************************************
+*** FUNCTION assemblePass2
+*********************************************************************
+*** DESCRIPTION : Finds the program (or control section) name and
+***               start address, generates
+***               object code per line with BASE/EXTDEF/EXTREF
+***               handling against the Pass 1 tables already loaded
+***               into prog, and computes the program length. With
+***               jobs > 1 the lines are split into chunks assembled
+***               on a thread pool; the BASE value for each line comes
+***               from a prefix scan, and chunk images and errors are
+***               merged in line order, so output is identical.
+*** INPUT ARGS : optab - opcode/format lookup
+***              jobs  - worker threads for code generation
+*** OUTPUT ARGS : prog - program name, start, length and tables
+*** IN/OUT ARGS : lines - listing lines annotated with object code
+***               stats - gets a trace span per parallel chunk
+***               cache - with --incremental: lines whose key is
+***                       cached skip genObj; afterwards it holds
+***                       this run's keys (may be null)
+*** RETURN : void
+********************************************************************/
+void assemblePass2(std::vector<Line> &lines, const OpcodeTable &optab, Pass2Program &prog,
+                   int jobs, RunStats *stats, ObjectCache *cache) {
+    int &startAddr = prog.startAddr;
+    string &programName = prog.programName;
+    for (auto &L : lines) {
+        if (L.op == "START" || L.op == "CSECT") {
+            startAddr = L.locctr;
+            prog.controlSection = (L.op == "CSECT");
+            if (!L.label.empty()) {
+                programName = L.label;
+                if (!programName.empty() && programName.back() == ':')
+                    programName.pop_back();
+            }
+            break;
+        }
+    }
+
+    const map<string,int> &symaddr = prog.symaddr;
+    const map<string,int> &litaddr = prog.litaddr;
+
+    // BASE/NOBASE prefix scan: the BASE value in effect at each line
+    std::vector<int> baseAt(lines.size());
+    int baseReg = -1;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const Line &L = lines[i];
+        if (L.op=="BASE") {
+            auto si = symaddr.find(symbolKey(L.operand));
+            if (si != symaddr.end()) baseReg = si->second;
+        }
+        else if (L.op=="NOBASE") baseReg = -1;
+        else if (L.op=="EXTDEF") { auto v = splitCSV(L.operand); prog.extdefs.insert(prog.extdefs.end(), v.begin(), v.end()); }
+        else if (L.op=="EXTREF") addExtrefs(prog, L.operand);
+        baseAt[i] = baseReg;
+    }
+
+    // With a cache, each line's key and whether its code came from the
+    // cache (HIT) or from a genObj call without diagnostics (FRESH)
+    enum { UNCACHED = 0, HIT, FRESH };
+    std::vector<ObjectCache::Key> keys(cache ? lines.size() : 0);
+    std::vector<char> cached(cache ? lines.size() : 0, UNCACHED);
+
+    // Generate object code for lines [begin, end) into one image/error list
+    auto genRange = [&](size_t begin, size_t end, std::vector<uint8_t> &image,
+                        std::vector<Diagnostic> &errs) {
+        for (size_t i = begin; i < end; ++i) {
+            Line &L = lines[i];
+            if (L.op=="BASE") {
+                if (!symaddr.count(symbolKey(L.operand)))
+                    addErr(errs, L.lineNum, "BASE undefined symbol: " + L.operand);
+                continue;
+            }
+            if (L.op=="NOBASE" || L.op=="EXTDEF" || L.op=="EXTREF" || L.op=="CSECT") continue;
+
+            if (cache) {
+                keys[i] = ObjectCache::keyFor(L, baseAt[i], symaddr, litaddr, &prog.externals);
+                if (cache->lookup(keys[i], L, image)) { cached[i] = HIT; continue; }
+                size_t before = errs.size();
+                genObj(L, symaddr, litaddr, optab, baseAt[i], image, errs, &prog.externals);
+                if (errs.size() == before) cached[i] = FRESH;
+                continue;
+            }
+            genObj(L, symaddr, litaddr, optab, baseAt[i], image, errs, &prog.externals);
+        }
+    };
+
+    // Object bytes for every line, in line order (3 per line is typical)
+    prog.image.clear();
+    prog.image.reserve(lines.size() * 3);
+
+    const size_t MIN_CHUNK = 4096;
+    size_t chunks = 1;
+    if (jobs > 1 && lines.size() >= 2 * MIN_CHUNK)
+        chunks = std::min((size_t)jobs * 4, lines.size() / MIN_CHUNK);
+
+    if (chunks <= 1) {
+        genRange(0, lines.size(), prog.image, prog.errors);
+    } else {
+        // Chunks fill private images/error lists; merged back in line order
+        size_t per = (lines.size() + chunks - 1) / chunks;
+        std::vector<std::vector<uint8_t>> images(chunks);
+        std::vector<std::vector<Diagnostic>> errs(chunks);
+        {
+            ThreadPool pool(jobs);
+            pool.parallelFor(chunks, [&](size_t c) {
+                AllocPhase phase("code generation");
+                TraceLog::Clock::time_point t0 = TraceLog::Clock::now();
+                size_t begin = c * per, end = std::min(lines.size(), begin + per);
+                images[c].reserve((end - begin) * 3);
+                genRange(begin, end, images[c], errs[c]);
+                if (stats)
+                    stats->traceSpan("code generation chunk", t0,
+                                     {{"chunk", (double)c}, {"lines", (double)(end - begin)},
+                                      {"bytes", (double)images[c].size()}});
+            });
+        }
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t begin = c * per, end = std::min(lines.size(), begin + per);
+            int shift = (int)prog.image.size();
+            for (size_t i = begin; i < end; ++i) lines[i].objOffset += shift;
+            prog.image.insert(prog.image.end(), images[c].begin(), images[c].end());
+            prog.errors.insert(prog.errors.end(), std::make_move_iterator(errs[c].begin()),
+                            std::make_move_iterator(errs[c].end()));
+        }
+    }
+
+    if (cache) {
+        long hits = 0, generated = 0;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (cached[i] == UNCACHED) continue;
+            if (cached[i] == HIT) ++hits;
+            else ++generated;
+            cache->keep(keys[i], lines[i], prog.image);
+        }
+        cache->hits = hits;
+        cache->misses = generated;
+    }
+
+    // M records, in line order (only format 4 and WORD lines can need one)
+    prog.modifications.clear();
+    for (const Line &L : lines) noteModification(L, prog);
+
+    // Compute program length (exclude EQU absolute values)
+    int &progLen = prog.progLen;
+    {
+        int maxLocPlusSize = startAddr;
+        for (auto &L : lines) {
+            if (L.op=="EQU") continue;      // its LOCCTR column holds the EQU value
+            int sz = 0;
+            if (L.objLen > 0) sz = L.objLen;
+            else if (L.op=="RESW") sz = (isDigits(L.operand)? stoi(L.operand)*3:0);
+            else if (L.op=="RESB") sz = (isDigits(L.operand)? stoi(L.operand):0);
+            else if (L.isLiteral) sz = L.sizeBytes;
+            int candidate = L.locctr + sz;
+            if (candidate > maxLocPlusSize) maxLocPlusSize = candidate;
+        }
+        progLen = maxLocPlusSize - startAddr;
+        // Override with END locctr + trailing literal sizes if END present (matches pass1)
+        int endLoc = -1;
+        for (auto &L : lines) if (L.op=="END") endLoc = L.locctr;
+        if (endLoc >= 0) {
+            int tailSize = 0;
+            for (auto &L : lines) if (L.isLiteral && L.locctr >= endLoc) tailSize += L.sizeBytes;
+            progLen = (endLoc - startAddr) + tailSize;
+        }
+        // A control section the next CSECT ends has no END: Pass 1 knows its length
+        else if (prog.sectionLength >= 0) progLen = prog.sectionLength;
+    }
+}
+
+/********************************************************************
+*** FUNCTION splitListingSections
+*********************************************************************
+*** DESCRIPTION : Cut the listing before each CSECT row that follows
+***               other lines: one section per control section, in
+***               order, with empty program state.
+*** INPUT ARGS : none
+*** OUTPUT ARGS : sections - replaced
+*** IN/OUT ARGS : lines - moved into the sections
+*** RETURN : void
+********************************************************************/
+void splitListingSections(std::vector<Line> &lines, std::vector<Pass2Section> &sections) {
+    sections.clear();
+    sections.emplace_back();
+    for (auto &L : lines) {
+        if (L.op == "CSECT" && !sections.back().lines.empty()) sections.emplace_back();
+        sections.back().lines.push_back(std::move(L));
+    }
+    lines.clear();
+}
+
+/********************************************************************
+*** FUNCTION assembleSections
+*********************************************************************
+*** DESCRIPTION : assemblePass2 for every control section. A single
+***               section keeps jobs for its own chunks. Several
+***               sections share nothing but the opcode table, so
+***               they are assembled concurrently, one per task;
+***               with a cache (not thread-safe) they run in order
+***               and its hit/miss counts cover them all.
+*** INPUT ARGS : optab - opcode/format lookup
+***              jobs  - worker threads
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : sections - lines annotated, programs filled in
+***               stats - trace spans (may be null)
+***               cache - --incremental cache (may be null)
+*** RETURN : void
+********************************************************************/
+void assembleSections(std::vector<Pass2Section> &sections, const OpcodeTable &optab,
+                      int jobs, RunStats *stats, ObjectCache *cache) {
+    if (sections.size() == 1) {
+        assemblePass2(sections[0].lines, optab, sections[0].prog, jobs, stats, cache);
+        return;
+    }
+    if (cache) {
+        long hits = 0, misses = 0;
+        for (auto &sec : sections) {
+            assemblePass2(sec.lines, optab, sec.prog, 1, stats, cache);
+            hits += cache->hits;
+            misses += cache->misses;
+        }
+        cache->hits = hits;
+        cache->misses = misses;
+        return;
+    }
+    ThreadPool pool(std::max(1, std::min(jobs, (int)sections.size())));
+    pool.parallelFor(sections.size(), [&](size_t k) {
+        AllocPhase phase("code generation");
+        TraceLog::Clock::time_point t0 = TraceLog::Clock::now();
+        assemblePass2(sections[k].lines, optab, sections[k].prog);
+        if (stats)
+            stats->traceSpan("control section", t0,
+                             {{"section", (double)k}, {"lines", (double)sections[k].lines.size()},
+                              {"bytes", (double)sections[k].prog.image.size()}});
+    });
+}
+
+/********************************************************************
+*** FUNCTION writeListingHeader / writeListingRow
+*********************************************************************
+*** DESCRIPTION : Listing column header, and one listing row with
+***               its object code. Shared by the in-memory and the
+***               streaming writers so both produce the same bytes.
+*** INPUT ARGS : L    - assembled line
+***              code - its object bytes (L.objLen of them)
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : lst - listing output stream
+*** RETURN : void
+********************************************************************/
+static void writeListingHeader(OutputBuffer &lst) {
+    lst.left("LINE#", 6);     // gives a trailing space
+    lst.left("LOCCTR", 8);
+    lst.left("LABEL", 8);
+    lst.left("OPERATION", 11);
+    lst.left("OPERAND", 13);
+    lst.put("OBJCODE\n");
+}
+
+static void writeListingRow(OutputBuffer &lst, const Line &L, const uint8_t *code) {
+    // LINE# (decimal, 2 digits), LOCCTR (hex, 5 digits)
+    lst.dec(L.lineNum, 2, '0');
+    lst.put("   ");
+    lst.hex((uint32_t)L.locctr & 0xFFFFF, 5);
+    lst.put("  ");
+
+    // LABEL, OPERATION, OPERAND (left)
+    lst.left(L.label, 8);
+    lst.left(L.op, 11);
+    lst.left(L.operand, 13);
+
+    // OBJCODE
+    lst.hexBytes(code, L.objLen);
+    lst.put('\n');
+}
+
+/********************************************************************
+*** FUNCTION writeListingTables
+*********************************************************************
+*** DESCRIPTION : Listing footer: program length, the symbol table
+***               with its R/I/M flags, and the literal table built
+***               from the literal pool rows.
+*** INPUT ARGS : prog     - program summary and tables
+***              literals - literal pool lines, in listing order
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : lst - listing output buffer
+*** RETURN : void
+********************************************************************/
+template <typename LiteralLines>
+static void writeListingTables(OutputBuffer &lst, const Pass2Program &prog,
+                               const LiteralLines &literals) {
+    // Footer: Program Length in hex (to match header)
+    lst.put("\nProgram Length = ");
+    lst.hex((uint32_t)prog.progLen);
+    lst.put('\n');
+
+    // Symbol Table (as Pass 1 left it: names, values and R/I/M flags)
+    lst.put("\nSymbol Table\n");
+    lst.left("LABEL", 10);
+    lst.left("VALUE", 8);
+    lst.left("RFLAG", 7);
+    lst.left("IFLAG", 7);
+    lst.left("MFLAG", 7);
+    lst.put('\n');
+
+    for (const auto &sym : prog.symbols) {
+        lst.left(sym.name, 10);
+        uint32_t v = (uint32_t)sym.value & 0xFFFFF;       // no zero pad
+        int digits = 1;
+        for (uint32_t t = v >> 4; t != 0; t >>= 4) ++digits;
+        lst.hex(v, digits);
+        lst.fill(' ', 8 - digits);
+        lst.left(sym.rflag ? "1" : "0", 7);
+        lst.left(sym.iflag ? "1" : "0", 7);
+        lst.left(sym.mflag ? "1" : "0", 7);
+        lst.put('\n');
+    }
+
+    // Literal Table (ADDR width 5, like your listing)
+    lst.put("\nLiteral Table\n");
+    lst.left("LITERAL", 12);
+    lst.left("VALUE", 10);
+    lst.put("  LEN  ADDR\n");
+
+    std::vector<uint8_t> bytes;
+    for (const Line &L : literals) if (L.isLiteral) {
+        bytes.clear();
+        if (L.op.size() >= 4 && L.op[0] == '=' && constantBytes(std::string_view(L.op).substr(1), bytes)) {
+            lst.left(L.op, 12);
+            lst.hexBytes(bytes.data(), (int)bytes.size());
+            lst.fill(' ', 10 - 2 * (int)bytes.size());
+            lst.dec((long)bytes.size(), 5);
+            lst.put(' ');
+            lst.hex((uint32_t)L.locctr & 0xFFFFF, 5);
+            lst.put('\n');
+        }
+    }
+}
+
+/********************************************************************
+*** FUNCTION writeListing
+*********************************************************************
+*** DESCRIPTION : Write the listing: header, one row per line with
+***               object code, the program length footer, and the
+***               symbol/literal tables with their R/I/M flags.
+*** INPUT ARGS : lines - assembled listing lines
+***              prog  - program summary and tables
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : lst - listing output stream
+*** RETURN : void
+********************************************************************/
+void writeListing(std::ostream &os, const std::vector<Line> &lines, const Pass2Program &prog) {
+    OutputBuffer lst(os);
+    writeListingHeader(lst);
+    for (auto &L : lines) writeListingRow(lst, L, prog.image.data() + L.objOffset);
+    writeListingTables(lst, prog, lines);
+}
+
+/********************************************************************
+*** FUNCTION writeObjectHeader
+*********************************************************************
+*** DESCRIPTION : H record, then D/R records when EXTDEF/EXTREF
+***               were seen.
+*** INPUT ARGS : prog - program summary and tables
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : obj - object output stream
+*** RETURN : void
+********************************************************************/
+static void writeObjectHeader(OutputBuffer &obj, const Pass2Program &prog) {
+    const map<string,int> &symaddr = prog.symaddr;
+    obj.put("H^"); obj.put(prog.programName);
+    obj.put('^'); obj.hex((uint32_t)prog.startAddr, 6);
+    obj.put('^'); obj.hex((uint32_t)prog.progLen, 6);
+    obj.put('\n');
+
+    // Emit D/R records (after H, before T)
+    if (!prog.extdefs.empty()) {
+        obj.put('D');
+        for (const auto &name : prog.extdefs) {
+            obj.put('^'); obj.put(name);
+            auto it = symaddr.find(symbolKey(name));
+            obj.put('^'); obj.hex((uint32_t)(it==symaddr.end()?0:it->second), 6);
+        }
+        obj.put('\n');
+    }
+    if (!prog.extrefs.empty()) {
+        obj.put('R');
+        for (const auto &name : prog.extrefs) { obj.put('^'); obj.put(name); }
+        obj.put('\n');
+    }
+}
+
+// M records: address, length in half-bytes, and for an EXTREF symbol
+// "+NAME" (without one the loader adds the section's own load address)
+static void writeObjectModifications(OutputBuffer &obj, const Pass2Program &prog) {
+    for (const auto &m : prog.modifications) {
+        obj.put("M^");
+        obj.hex((uint32_t)m.address, 6);
+        obj.put('^');
+        obj.hex((uint32_t)m.halfBytes, 2);
+        if (!m.symbol.empty()) { obj.put("^+"); obj.put(m.symbol); }
+        obj.put('\n');
+    }
+}
+
+// E record: first executable instruction (the start address); a control
+// section after the first has none
+static void writeObjectEnd(OutputBuffer &obj, const Pass2Program &prog) {
+    if (prog.controlSection) {
+        obj.put("E\n");
+        return;
+    }
+    obj.put("E^");
+    obj.hex((uint32_t)prog.startAddr, 6);
+    obj.put('\n');
+}
+
+/********************************************************************
+*** FUNCTION TextRecordWriter::add
+*********************************************************************
+*** DESCRIPTION : Append one line's object code to the open T
+***               record (each line stays its own ^-separated field).
+***               A line without object code, a LOCCTR gap or a
+***               record that would pass 30 bytes closes the record.
+*** INPUT ARGS : locctr - address of the line
+***              code   - its object bytes
+***              len    - number of bytes (0 for none)
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : none
+*** RETURN : void
+********************************************************************/
+void TextRecordWriter::add(int locctr, const uint8_t *code, int len) {
+    const int MAX_TEXT = 30;
+    if (len == 0) {                      // gaps/directives force flush
+        flush();
+        prevEnd = -1;
+        return;
+    }
+    bool gap = (prevEnd!=-1 && locctr != prevEnd);
+    bool overflow = (recLen + len > MAX_TEXT);
+    if (recStart==-1 || gap || overflow) {
+        flush();
+        recStart = locctr;
+    }
+    bytes.insert(bytes.end(), code, code + len);
+    fieldLens.push_back(len);
+    recLen += len;
+    prevEnd = locctr + len;
+}
+
+/********************************************************************
+*** FUNCTION TextRecordWriter::flush
+*********************************************************************
+*** DESCRIPTION : Write the open T record, if any, and start over.
+*** INPUT ARGS : none
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : none
+*** RETURN : void
+********************************************************************/
+void TextRecordWriter::flush() {
+    if (recLen==0) return;
+    out.put("T^");
+    out.hex((uint32_t)recStart, 6);
+    out.put('^');
+    out.hex((uint32_t)recLen, 2);
+    const uint8_t *p = bytes.data();
+    for (int len : fieldLens) {
+        out.put('^');
+        out.hexBytes(p, len);
+        p += len;
+    }
+    out.put('\n');
+    bytes.clear(); fieldLens.clear(); recLen = 0; recStart = -1;
+}
+
+/********************************************************************
+*** FUNCTION writeObjectProgram
+*********************************************************************
+*** DESCRIPTION : Write the object program: H record, D/R records
+***               when EXTDEF/EXTREF were seen, T records batched up
+***               to 30 bytes (split on gaps), M records, and the E
+***               record.
+*** INPUT ARGS : lines - assembled listing lines
+***              prog  - program summary and tables
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : obj - object output stream
+*** RETURN : void
+********************************************************************/
+void writeObjectProgram(std::ostream &os, const std::vector<Line> &lines, const Pass2Program &prog) {
+    OutputBuffer obj(os);
+    writeObjectHeader(obj, prog);
+    TextRecordWriter text(obj);
+    for (auto &L : lines) text.add(L.locctr, prog.image.data() + L.objOffset, L.objLen);
+    text.flush();
+    writeObjectModifications(obj, prog);
+    writeObjectEnd(obj, prog);
+}
+
+// A blank line between the listings of consecutive control sections
+void writeListing(std::ostream &os, const std::vector<Pass2Section> &sections) {
+    for (size_t k = 0; k < sections.size(); ++k) {
+        if (k > 0) os << "\n";
+        writeListing(os, sections[k].lines, sections[k].prog);
+    }
+}
+
+void writeObjectProgram(std::ostream &os, const std::vector<Pass2Section> &sections) {
+    for (const auto &sec : sections) writeObjectProgram(os, sec.lines, sec.prog);
+}
+
+// Console titles the listing and object program are echoed under
+static const char LISTING_TITLE[] = "===================Listing File===================";
+static const char OBJECT_TITLE[]  = "===========Object Program File===========";
+
+/********************************************************************
+*** FUNCTION announcePass2Files / finishPass2Sinks
+*********************************************************************
+*** DESCRIPTION : The "... written to:" lines, and closing both
+***               artifact sinks (reporting the first failure).
+*** INPUT ARGS : lst, obj - artifact sinks
+*** OUTPUT ARGS : err - reason on failure
+*** IN/OUT ARGS : con - console stream
+*** RETURN : bool - false if a sink lost output
+********************************************************************/
+static void announcePass2Files(std::ostream &con, const OutputSink &lst, const OutputSink &obj) {
+    con << "Listing file written to: " << lst.name() << "\n";
+    con << "Object file written to: " << obj.name() << "\n\n";
+}
+
+static bool finishPass2Sinks(OutputSink &lst, OutputSink &obj, std::string &err) {
+    bool ok = lst.finish(err);
+    std::string objErr;
+    if (!obj.finish(objErr) && ok) { err = objErr; ok = false; }
+    return ok;
+}
+
+/********************************************************************
+*** FUNCTION Pass2Stream (constructor)
+*********************************************************************
+*** DESCRIPTION : Binds the stream to its artifact sinks; with echo
+***               each is teed to stdout as it is written.
+*** INPUT ARGS : optab - opcode/format lookup
+***              lst, obj - listing and object program sinks
+***              con  - console stream; echo - tee artifacts to it
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : prog - program tables in, summary/errors out
+*** RETURN : n/a
+********************************************************************/
+Pass2Stream::Pass2Stream(const OpcodeTable &optab, Pass2Program &prog, OutputSink &lst,
+                         OutputSink &obj, std::ostream &con, bool echo)
+    : optab(optab), prog(prog), con(con), echo(echo),
+      lstTee(lst, screen), objTee(obj, screen),
+      lstSink(echo ? static_cast<OutputSink&>(lstTee) : lst),
+      objSink(echo ? static_cast<OutputSink&>(objTee) : obj),
+      lstStream(lstSink), lstOut(lstStream), spoolOut(spool), text(spoolOut) {}
+
+/********************************************************************
+*** FUNCTION Pass2Stream::open
+*********************************************************************
+*** DESCRIPTION : Opens the T-record spool file, announces the
+***               outputs and writes the listing header.
+*** INPUT ARGS : spoolFileName - scratch file for T records
+*** OUTPUT ARGS : err - reason on failure
+*** IN/OUT ARGS : none
+*** RETURN : bool - false if the spool could not be opened
+********************************************************************/
+bool Pass2Stream::open(const std::string &spoolFileName, std::string &err) {
+    spoolPath = spoolFileName;
+    spool.open(spoolPath, std::ios::in | std::ios::out | std::ios::trunc);
+    if (!spool) {
+        err = "Cannot write " + spoolPath;
+        return false;
+    }
+    announcePass2Files(con, lstSink, objSink);
+    if (echo) con << "\n" << LISTING_TITLE << "\n";
+    writeListingHeader(lstOut);
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION Pass2Stream::add
+*********************************************************************
+*** DESCRIPTION : Assemble one line in the same way assemblePass2
+***               does (START, BASE/NOBASE, EXTDEF/EXTREF, genObj;
+***               CSECT is an error, sections need the whole
+***               listing), then write its listing row and
+***               batch its bytes into the open T record. Only
+***               literal pool lines are kept, for the literal table
+***               and the program length.
+*** INPUT ARGS : none
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : L - next line, annotated with its object code
+*** RETURN : void
+********************************************************************/
+void Pass2Stream::add(Line &L) {
+    const map<string,int> &symaddr = prog.symaddr;
+    code.clear();
+    L.objOffset = 0; L.objLen = 0;
+
+    if (L.op == "START" && !seenStart) {
+        seenStart = true;
+        prog.startAddr = L.locctr;
+        if (!L.label.empty()) {
+            prog.programName = L.label;
+            if (prog.programName.back() == ':') prog.programName.pop_back();
+        }
+    }
+
+    if (L.op=="BASE") {
+        auto si = symaddr.find(symbolKey(L.operand));
+        if (si != symaddr.end()) baseReg = si->second;
+        else addErr(prog.errors, L.lineNum, "BASE undefined symbol: " + L.operand);
+    }
+    else if (L.op=="NOBASE") baseReg = -1;
+    else if (L.op=="EXTDEF") { auto v = splitCSV(L.operand); prog.extdefs.insert(prog.extdefs.end(), v.begin(), v.end()); }
+    else if (L.op=="EXTREF") addExtrefs(prog, L.operand);
+    else if (L.op=="CSECT")  addErr(prog.errors, L.lineNum, "CSECT: control sections are not supported with --stream");
+    else {
+        genObj(L, symaddr, prog.litaddr, optab, baseReg, code, prog.errors, &prog.externals);
+        noteModification(L, prog);
+    }
+    if (counts) counts->add(L, code.data(), optab);
+
+    // Program length inputs (same rules as assemblePass2)
+    int sz = 0;
+    if (L.objLen > 0) sz = L.objLen;
+    else if (L.op=="RESW") sz = (isDigits(L.operand)? stoi(L.operand)*3:0);
+    else if (L.op=="RESB") sz = (isDigits(L.operand)? stoi(L.operand):0);
+    else if (L.isLiteral) sz = L.sizeBytes;
+    if (L.op!="EQU") {                  // an EQU's LOCCTR column holds its value
+        if (!anyLine || L.locctr + sz > maxEnd) maxEnd = L.locctr + sz;
+        anyLine = true;
+    }
+    if (L.op=="END") endLoc = L.locctr;
+    if (L.isLiteral) literals.push_back(L);
+
+    writeListingRow(lstOut, L, code.data());
+    text.add(L.locctr, code.data(), L.objLen);
+}
+
+/********************************************************************
+*** FUNCTION Pass2Stream::finish
+*********************************************************************
+*** DESCRIPTION : Closes the last T record, computes the program
+***               length, appends the listing tables, and writes the
+***               object file: H/D/R, the spooled T records, M, E.
+*** INPUT ARGS : none
+*** OUTPUT ARGS : err - reason on failure
+*** IN/OUT ARGS : none
+*** RETURN : bool - false if an output file could not be written
+********************************************************************/
+bool Pass2Stream::finish(std::string &err) {
+    text.flush();
+
+    int maxLocPlusSize = prog.startAddr;
+    if (anyLine && maxEnd > maxLocPlusSize) maxLocPlusSize = maxEnd;
+    prog.progLen = maxLocPlusSize - prog.startAddr;
+    // Override with END locctr + trailing literal sizes if END present (matches pass1)
+    if (endLoc >= 0) {
+        int tailSize = 0;
+        for (auto &L : literals) if (L.locctr >= endLoc) tailSize += L.sizeBytes;
+        prog.progLen = (endLoc - prog.startAddr) + tailSize;
+    }
+    else if (prog.sectionLength >= 0) prog.progLen = prog.sectionLength;
+
+    writeListingTables(lstOut, prog, literals);
+    lstOut.flush();
+    spoolOut.flush();
+
+    if (echo) con << "\n" << OBJECT_TITLE << "\n";
+    {
+        SinkStream objStream(objSink);
+        OutputBuffer objOut(objStream);
+        writeObjectHeader(objOut, prog);
+        spool.seekg(0);
+        char chunk[1 << 16];
+        while (spool.read(chunk, sizeof(chunk)) || spool.gcount() > 0)
+            objOut.put(std::string_view(chunk, (size_t)spool.gcount()));
+        writeObjectModifications(objOut, prog);
+        writeObjectEnd(objOut, prog);
+    }
+    spool.close();
+    std::remove(spoolPath.c_str());
+    return finishPass2Sinks(lstSink, objSink, err);
+}
+
+/********************************************************************
+*** FUNCTION writePass2Files
+*********************************************************************
+*** DESCRIPTION : Write the listing and object program to their
+***               sinks and announce them on the console. With echo
+***               each artifact is teed to stdout, under its title,
+***               while it is written (nothing is read back).
+*** INPUT ARGS : sections - assembled program, by control section
+***              con  - console stream
+***              echo - also print both artifacts on stdout
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : lst, obj - artifact sinks (finished on return)
+*** RETURN : bool - false if either artifact could not be written
+********************************************************************/
+bool writePass2Files(const std::vector<Pass2Section> &sections,
+                     OutputSink &lst, OutputSink &obj, std::ostream &con, bool echo,
+                     RunStats *stats) {
+    StdoutSink screen;
+    TeeSink lstTee(lst, screen), objTee(obj, screen);
+    CountingSink lstOut(echo ? static_cast<OutputSink&>(lstTee) : lst);
+    CountingSink objOut(echo ? static_cast<OutputSink&>(objTee) : obj);
+
+    announcePass2Files(con, lst, obj);
+    if (echo) con << "\n" << LISTING_TITLE << "\n";
+    {
+        PhaseTimer t(stats, "listing write");
+        {
+            SinkStream os(lstOut);
+            writeListing(os, sections);
+        }
+        t.arg("bytes", (double)lstOut.bytes());
+    }
+    if (echo) con << "\n" << OBJECT_TITLE << "\n";
+    {
+        PhaseTimer t(stats, "T-record emission");
+        {
+            SinkStream os(objOut);
+            writeObjectProgram(os, sections);
+        }
+        t.arg("bytes", (double)objOut.bytes());
+    }
+    string err;
+    if (!finishPass2Sinks(lstOut, objOut, err)) {
+        cerr << err << "\n";
+        return false;
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION EncodingCounts::add / report
+*********************************************************************
+*** DESCRIPTION : Count one assembled line by instruction format;
+***               for 3-byte format 3 code, bits b/p of the xbpe
+***               nibble tell base-relative, PC-relative or direct.
+***               report() hands the totals to --stats.
+*** INPUT ARGS : L, code - line and its object bytes; optab
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : stats - counters are set on it
+*** RETURN : void
+********************************************************************/
+void EncodingCounts::add(const Line &L, const uint8_t *code, const OpcodeTable &optab) {
+    OpcodeTable::Entry e;
+    if (L.objLen == 0 || L.isLiteral || !optab.lookup(L.op, e)) return;
+    int f = (L.op[0] == '+') ? 4 : e.format;
+    if (f < 1 || f > 4) return;
+    ++format[f];
+    if (f == 3 && L.objLen == 3) {
+        if (code[1] & 0x40) ++baseRelative;
+        else if (code[1] & 0x20) ++pcRelative;
+        else ++direct;
+    }
+}
+
+void EncodingCounts::report(RunStats &stats) const {
+    stats.setCount("format 1", format[1]);
+    stats.setCount("format 2", format[2]);
+    stats.setCount("format 3", format[3]);
+    stats.setCount("format 4", format[4]);
+    stats.setCount("PC-relative", pcRelative);
+    stats.setCount("BASE-relative", baseRelative);
+    stats.setCount("direct (format 3)", direct);
+}
+
+/********************************************************************
+*** FUNCTION printPass2Report
+*********************************************************************
+*** DESCRIPTION : Finish a Pass 2 run on the console with the
+***               categorized error summary and the error list.
+*** INPUT ARGS : prog - assembled program (for its errors)
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : os - console stream
+*** RETURN : void
+********************************************************************/
+void printPass2Report(const Pass2Program &prog, std::ostream &os) {
+    const std::vector<Diagnostic> &errors = prog.errors;
+    if (!errors.empty()) {
+        printErrorCategorySummary(errors, os);
+        os << "\nErrors (" << errors.size() << "):\n";
+        for (auto &e : errors) os << "  " << e.text() << "\n";
+    } else {
+        os << "\nNo Pass 2 errors detected.\n";
+    }
+
+    os << "\n========== PASS 2 COMPLETE ==========\n";
+}
+
+// Several control sections report as one program: their errors in order
+void printPass2Report(const std::vector<Pass2Section> &sections, std::ostream &os) {
+    if (sections.size() == 1) { printPass2Report(sections[0].prog, os); return; }
+    Pass2Program all;
+    for (const auto &s : sections)
+        all.errors.insert(all.errors.end(), s.prog.errors.begin(), s.prog.errors.end());
+    printPass2Report(all, os);
+}
+
+/********************************************************************
+*** FUNCTION printPass2Errors
+*********************************************************************
+*** DESCRIPTION : Just the Pass 2 errors, one per line (what --quiet
+***               still reports, on stderr).
+*** INPUT ARGS : prog - assembled program
+*** OUTPUT ARGS : none
+*** IN/OUT ARGS : os - output stream
+*** RETURN : void
+********************************************************************/
+void printPass2Errors(const Pass2Program &prog, std::ostream &os) {
+    for (auto &e : prog.errors) os << e.text() << "\n";
+}
+
+void printPass2Errors(const std::vector<Pass2Section> &sections, std::ostream &os) {
+    for (const auto &s : sections) printPass2Errors(s.prog, os);
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "OpcodeTable.h"
+#include "SymbolTable.h"
+#include "OutputBuffer.h"
+#include "OutputSink.h"
+#include "Diagnostic.h"
+
+// Listing line model
+struct Line {
+    int lineNum = 0;
+    int locctr  = 0;  // parsed from hex
+    std::string label;     // may be "" or "*"
+    std::string op;        // uppercase mnemonic or directive
+    std::string operand;   // raw operand (e.g., =C'ABCD', @RETADR)
+    bool isLiteral = false; // label == "*"
+    int objOffset = 0;     // generated object code: bytes [objOffset, objOffset+objLen)
+    int objLen = 0;        //   of Pass2Program::image (hex only when written out)
+    int sizeBytes = 0; // length of generated bytes (or reserved)
+};
+
+// One M record: the field at address, halfBytes long (5 for a format 4
+// address, 6 for a WORD), gets the section's load address added, or with
+// symbol set, that EXTREF symbol's address
+struct Modification {
+    int address = 0;
+    int halfBytes = 0;
+    std::string symbol;
+};
+
+// Program-level state: tables come from Pass 1 (.sym or in memory),
+// the rest is derived from the listing lines
+struct Pass2Program {
+    std::string programName = "PROG";
+    int startAddr = 0;
+    int progLen = 0;
+    int sectionLength = -1;              // Pass 1's, if a later CSECT ends the section; else -1
+    std::vector<SymbolTable::Record> symbols;  // Pass 1 symbol table, by name
+    std::map<std::string,int> symaddr;   // symbolKey(name) -> value
+    std::map<std::string,int> litaddr;   // literal token -> address
+    std::set<std::string> absolutes;     // symbolKey of symbols with RFLAG 0 (absolute EQU)
+    std::vector<std::string> extdefs;
+    std::vector<std::string> extrefs;
+    std::set<std::string> externals;     // symbolKey of each EXTREF name
+    bool controlSection = false;         // named by CSECT: its E record has no address
+    std::vector<uint8_t> image;          // object bytes of all lines, in line order
+    std::vector<Modification> modifications;  // M records, in line order
+    std::vector<Diagnostic> errors;      // Pass 2 diagnostics, in line order
+};
+
+// Parse a listing line from .int (false for header/blank/unusable rows)
+bool parseListing(const std::string &raw, Line &out);
+
+// Lookup key for symaddr: uppercased, truncated to 6 chars like SymbolTable
+std::string symbolKey(std::string_view name);
+
+// Tables, object code and program length for an already-parsed listing
+// (prog.symbols/symaddr/litaddr must already be loaded from Pass 1)
+// jobs > 1 generates code for chunks of lines in parallel (same output),
+// each chunk a trace span on its worker when stats are traced. With a
+// cache, lines it already holds code for skip genObj (--incremental).
+class RunStats;
+class ObjectCache;
+void assemblePass2(std::vector<Line> &lines, const OpcodeTable &optab, Pass2Program &prog,
+                   int jobs = 1, RunStats *stats = nullptr, ObjectCache *cache = nullptr);
+
+// Object code for one line, appended to image (the per-line step of
+// assemblePass2 and Pass2Stream); baseReg is -1 when no BASE is in effect.
+// Names in externals (EXTREF) assemble as 0 in format 4 and WORD fields,
+// for the loader to fill in.
+void genObj(Line &L, const std::map<std::string,int> &symaddr,
+            const std::map<std::string,int> &litaddr, const OpcodeTable &optab,
+            int baseReg, std::vector<uint8_t> &image, std::vector<Diagnostic> &errs,
+            const std::set<std::string> *externals = nullptr);
+
+/********************************************************************
+*** STRUCT Pass2Section
+*********************************************************************
+*** DESCRIPTION : One control section: its listing lines and its
+***               own program state (tables from its Pass 1 run,
+***               object code, H/D/R/T/M/E values). A program without
+***               CSECT is a single section.
+********************************************************************/
+struct Pass2Section {
+    std::vector<Line> lines;
+    Pass2Program prog;
+};
+
+// Split an intermediate listing before each CSECT row (lines is consumed)
+void splitListingSections(std::vector<Line> &lines, std::vector<Pass2Section> &sections);
+
+// assemblePass2 for every section: one section as it is (with jobs and
+// the cache), several concurrently on up to jobs threads
+void assembleSections(std::vector<Pass2Section> &sections, const OpcodeTable &optab,
+                      int jobs = 1, RunStats *stats = nullptr, ObjectCache *cache = nullptr);
+
+// --stats counters for generated code: instructions per format and how
+// format 3 operands were addressed (read back from the xbpe bits)
+struct EncodingCounts {
+    long format[5] = {0, 0, 0, 0, 0};   // [1]..[4]
+    long pcRelative = 0, baseRelative = 0, direct = 0;
+
+    void add(const Line &L, const uint8_t *code, const OpcodeTable &optab);
+    void report(RunStats &stats) const;
+};
+
+// Artifact writers (listing rows + appended tables, and H/D/R/T/M/E records)
+void writeListing(std::ostream &lst, const std::vector<Line> &lines, const Pass2Program &prog);
+void writeObjectProgram(std::ostream &obj, const std::vector<Line> &lines, const Pass2Program &prog);
+// Every section in order: listings one after another, and the H..E
+// records of each section in turn
+void writeListing(std::ostream &lst, const std::vector<Pass2Section> &sections);
+void writeObjectProgram(std::ostream &obj, const std::vector<Pass2Section> &sections);
+
+// Object program T-record batching: records of up to 30 bytes, one
+// ^-separated field per line, split on LOCCTR gaps and on lines without
+// object code. Only the open record is held in memory.
+class TextRecordWriter {
+public:
+    explicit TextRecordWriter(OutputBuffer &out) : out(out) {}
+    void add(int locctr, const uint8_t *code, int len);
+    void flush();
+
+private:
+    OutputBuffer &out;
+    int recStart = -1, recLen = 0, prevEnd = -1;
+    std::vector<uint8_t> bytes;      // open record's object code
+    std::vector<int> fieldLens;      // byte count of each field in it
+};
+
+/********************************************************************
+*** CLASS Pass2Stream
+*********************************************************************
+*** DESCRIPTION : Bounded-memory Pass 2. With the Pass 1 tables
+***               already in prog, each line given to add() is
+***               assembled, its listing row written and its bytes
+***               batched into T records at once; nothing per line is
+***               kept except literal pool rows, errors and M records. T records
+***               are spooled to a scratch file because the H/D/R
+***               records ahead of them need the program length and
+***               every EXTDEF/EXTREF. Output (and console echo) is
+***               identical to assemblePass2 + writePass2Files.
+********************************************************************/
+class Pass2Stream {
+public:
+    Pass2Stream(const OpcodeTable &optab, Pass2Program &prog, OutputSink &lst,
+                OutputSink &obj, std::ostream &con, bool echo);
+    bool open(const std::string &spoolFileName, std::string &err);
+    void add(Line &L);
+    bool finish(std::string &err);   // also finishes both sinks
+    void countEncodings(EncodingCounts *c) { counts = c; }
+
+private:
+    const OpcodeTable &optab;
+    Pass2Program &prog;
+    std::ostream &con;
+    bool echo;
+    StdoutSink screen;
+    TeeSink lstTee, objTee;
+    OutputSink &lstSink, &objSink;   // the tees when echoing
+    SinkStream lstStream;
+    OutputBuffer lstOut;
+    std::fstream spool;
+    OutputBuffer spoolOut;
+    TextRecordWriter text;
+    std::string spoolPath;
+    std::vector<uint8_t> code;       // current line's object bytes
+    std::vector<Line> literals;      // literal pool rows, in order
+    bool seenStart = false, anyLine = false;
+    int baseReg = -1;
+    int maxEnd = 0;                  // highest locctr + size seen
+    int endLoc = -1;
+    EncodingCounts *counts = nullptr;
+};
+
+// Write both artifacts to their sinks and announce them on con; with echo
+// each is also printed on stdout as it is written. With stats, the listing
+// and object program write times are added to it.
+bool writePass2Files(const std::vector<Pass2Section> &sections,
+                     OutputSink &lst, OutputSink &obj, std::ostream &con, bool echo,
+                     RunStats *stats = nullptr);
+// Error summary and closing banner; just the errors (for --quiet)
+void printPass2Report(const Pass2Program &prog, std::ostream &os = std::cout);
+void printPass2Report(const std::vector<Pass2Section> &sections, std::ostream &os = std::cout);
+void printPass2Errors(const Pass2Program &prog, std::ostream &os);
+void printPass2Errors(const std::vector<Pass2Section> &sections, std::ostream &os);
@@ -0,0 +1,163 @@
+#include "RunStats.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+
+long peakRssKb() {
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? (long)ru.ru_maxrss : 0;
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (stats) stats->addPhase(phase, t0, args);
+}
+
+RunStats::RunStats(const std::string &tool, const std::string &file)
+    : tool(tool), file(file), start(Clock::now()) {}
+
+/********************************************************************
+*** FUNCTION RunStats::addTime / setCount                         ***
+*********************************************************************
+*** DESCRIPTION : Adds to a phase's time (a phase timed several   ***
+***               times is summed) / sets a counter. New names go ***
+***               to the end, so output follows first use.        ***
+*** INPUT ARGS  : phase/name, ms/value                            ***
+********************************************************************/
+void RunStats::addTime(const std::string &phase, double ms) {
+    for (auto &p : phases)
+        if (p.first == phase) { p.second += ms; return; }
+    phases.emplace_back(phase, ms);
+}
+
+void RunStats::addTimes(const RunStats &other) {
+    for (const auto &p : other.phases) addTime(p.first, p.second);
+}
+
+void RunStats::setCount(const std::string &name, long value) {
+    for (auto &c : counters)
+        if (c.first == name) { c.second = value; return; }
+    counters.emplace_back(name, value);
+}
+
+/********************************************************************
+*** FUNCTION RunStats::addPhase / traceSpan / traceRun            ***
+*********************************************************************
+*** DESCRIPTION : Trace side of the stats. addPhase also adds the ***
+***               time to the phase; the others only record spans ***
+***               ("phase", "step" and "file" categories).        ***
+*** INPUT ARGS  : phase/name, begin - span start; args            ***
+********************************************************************/
+void RunStats::addPhase(const char *phase, TraceLog::Clock::time_point begin,
+                        const TraceArgs &args) {
+    TraceLog::Clock::time_point end = TraceLog::Clock::now();
+    addTime(phase, std::chrono::duration<double, std::milli>(end - begin).count());
+    if (trace) trace->span(phase, "phase", begin, end, args);
+}
+
+void RunStats::traceSpan(const std::string &name, TraceLog::Clock::time_point begin,
+                         const TraceArgs &args) const {
+    if (trace) trace->span(name, "step", begin, TraceLog::Clock::now(), args);
+}
+
+void RunStats::traceRun() const {
+    if (!trace) return;
+    TraceArgs args;
+    for (const auto &c : counters) args.emplace_back(c.first, (double)c.second);
+    trace->span(tool + " " + file, "file", start, Clock::now(), args);
+}
+
+// JSON string body (names and paths only need quote/backslash escaping)
+static void jsonString(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+/********************************************************************
+*** FUNCTION RunStats::print                                      ***
+*********************************************************************
+*** DESCRIPTION : Phase table (ms and share of the total), then   ***
+***               the counters and peak RSS.                      ***
+*** IN/OUT ARGS : os - output stream                              ***
+********************************************************************/
+void RunStats::print(std::ostream &os) const {
+    double total = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::ios::fmtflags flags = os.flags();
+    os << "\n" << tool << " STATS (" << file << ")\n";
+    os << std::left << std::setw(24) << "PHASE" << std::right << std::setw(12) << "ms"
+       << std::setw(8) << "%" << "\n";
+    os << std::fixed;
+    for (const auto &p : phases) {
+        os << std::left << std::setw(24) << p.first << std::right << std::setprecision(3)
+           << std::setw(12) << p.second << std::setprecision(1) << std::setw(8)
+           << (total > 0 ? 100.0 * p.second / total : 0.0) << "\n";
+    }
+    os << std::left << std::setw(24) << "total (wall)" << std::right << std::setprecision(3)
+       << std::setw(12) << total << "\n\n";
+    for (const auto &c : counters)
+        os << std::left << std::setw(24) << c.first << std::right << std::setw(12) << c.second << "\n";
+    os << std::left << std::setw(24) << "peak RSS (KB)" << std::right << std::setw(12)
+       << peakRssKb() << "\n";
+    os.flags(flags);
+}
+
+/********************************************************************
+*** FUNCTION RunStats::printJson                                  ***
+*********************************************************************
+*** DESCRIPTION : The same figures as one JSON object on one line:***
+***               {"tool", "file", "total_ms", "phases_ms": {...},***
+***               "counters": {...}, "peak_rss_kb"}.              ***
+*** IN/OUT ARGS : os - output stream                              ***
+********************************************************************/
+void RunStats::printJson(std::ostream &os) const {
+    double total = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::ios::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(3);
+    os << "{\"tool\": ";
+    jsonString(os, tool);
+    os << ", \"file\": ";
+    jsonString(os, file);
+    os << ", \"total_ms\": " << total << ", \"phases_ms\": {";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        if (i) os << ", ";
+        jsonString(os, phases[i].first);
+        os << ": " << phases[i].second;
+    }
+    os << "}, \"counters\": {";
+    for (size_t i = 0; i < counters.size(); ++i) {
+        if (i) os << ", ";
+        jsonString(os, counters[i].first);
+        os << ": " << counters[i].second;
+    }
+    os << "}, \"peak_rss_kb\": " << peakRssKb() << "}\n";
+    os.flags(flags);
+}
+
+/********************************************************************
+*** FUNCTION RunStats::emit                                       ***
+*********************************************************************
+*** DESCRIPTION : Prints the table on stderr (so it never mixes   ***
+***               with artifacts on stdout) and/or writes the     ***
+***               JSON object.                                    ***
+*** INPUT ARGS  : text - print the table; jsonPath - "" for none, ***
+***               "-" for stdout, else a file                     ***
+*** OUTPUT ARGS : err - reason if the JSON file failed            ***
+*** RETURN      : bool - false if the JSON could not be written   ***
+********************************************************************/
+bool RunStats::emit(bool text, const std::string &jsonPath, std::string &err) const {
+    if (text) print(std::cerr);
+    if (jsonPath.empty()) return true;
+    if (jsonPath == "-") {
+        printJson(std::cout);
+        return true;
+    }
+    std::ofstream out(jsonPath);
+    if (out) printJson(out);
+    out.close();
+    if (!out) { err = "cannot write " + jsonPath; return false; }
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AllocStats.h"
+#include "TraceLog.h"
+
+/********************************************************************
+*** CLASS RunStats                                                ***
+*********************************************************************
+*** DESCRIPTION : What --stats reports: wall time per phase (in   ***
+***               the order phases first ran), named counters,    ***
+***               total wall time since construction and the      ***
+***               process's peak RSS. Printed as a table or as    ***
+***               one JSON object. With a TraceLog attached       ***
+***               (--trace), phases are also recorded as spans.   ***
+********************************************************************/
+class RunStats {
+public:
+    RunStats(const std::string &tool, const std::string &file);
+
+    void addTime(const std::string &phase, double ms);
+    // addTime for each of other's phases (counters are not merged)
+    void addTimes(const RunStats &other);
+    void setCount(const std::string &name, long value);
+
+    void attachTrace(TraceLog *log) { trace = log; }
+    bool tracing() const { return trace != nullptr; }
+    // addTime, plus a span from begin to now when tracing
+    void addPhase(const char *phase, TraceLog::Clock::time_point begin, const TraceArgs &args);
+    // Span from begin to now that is not a --stats phase (no-op unless tracing)
+    void traceSpan(const std::string &name, TraceLog::Clock::time_point begin,
+                   const TraceArgs &args) const;
+    // Span for the whole run, "<tool> <file>", with the counters as arguments
+    void traceRun() const;
+
+    void print(std::ostream &os) const;
+    void printJson(std::ostream &os) const;
+    // What the drivers do at exit: the table on stderr if text, and the
+    // JSON object to jsonPath ("-" = stdout) if it is not empty
+    bool emit(bool text, const std::string &jsonPath, std::string &err) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    std::string tool, file;
+    Clock::time_point start;
+    std::vector<std::pair<std::string, double>> phases;
+    std::vector<std::pair<std::string, long>> counters;
+    TraceLog *trace = nullptr;
+};
+
+/********************************************************************
+*** CLASS StopWatch                                               ***
+*********************************************************************
+*** DESCRIPTION : Adds the time until it goes out of scope to a   ***
+***               millisecond total. A null total turns it off    ***
+***               (no clock reads), so hot loops can keep it in   ***
+***               place when --stats is not given. A phase name   ***
+***               also makes it an AllocPhase (timed or not).     ***
+********************************************************************/
+class StopWatch {
+public:
+    explicit StopWatch(double *totalMs, const char *phase = nullptr)
+        : alloc(phase), total(totalMs) {
+        if (total) t0 = std::chrono::steady_clock::now();
+    }
+    ~StopWatch() {
+        if (total)
+            *total += std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - t0).count();
+    }
+    StopWatch(const StopWatch&) = delete;
+    StopWatch& operator=(const StopWatch&) = delete;
+
+private:
+    AllocPhase alloc;
+    double *total;
+    std::chrono::steady_clock::time_point t0;
+};
+
+// Times its scope into stats->addPhase(phase); only names the AllocPhase
+// for null stats. arg() attaches a value to the phase's trace span.
+class PhaseTimer {
+public:
+    PhaseTimer(RunStats *stats, const char *phase) : alloc(phase), stats(stats), phase(phase) {
+        if (stats) t0 = std::chrono::steady_clock::now();
+    }
+    ~PhaseTimer();
+    void arg(const char *name, double value) {
+        if (stats && stats->tracing()) args.emplace_back(name, value);
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    AllocPhase alloc;
+    RunStats *stats;
+    const char *phase;
+    std::chrono::steady_clock::time_point t0;
+    TraceArgs args;
+};
+
+// Peak resident set size of this process so far, in KB
+long peakRssKb();
@@ -0,0 +1,308 @@
+#include "SourceGenerator.h"
+#include <fstream>
+
+using namespace std;
+
+// Stop a program while a worst-case block plus the END pool still fits
+// below 1 MB (format 4 addresses are 20 bits)
+static const long ADDRESS_LIMIT = 0x100000;
+static const long BLOCK_BYTES   = 8192;
+static const int  BASE_PAD      = 2100;   // pushes base-block data out of PC range
+static const int  DATA_LINES    = 5;      // WORD, RESB, BYTE C, BYTE X, RESW
+static const size_t REUSE_WINDOW = 1024;
+
+static const char *const LOADS[]  = {"LDA", "LDX", "LDT", "LDS", "ADD", "SUB", "COMP", "MUL", "TIX"};
+static const char *const STORES[] = {"STA", "STX", "STT", "STS", "STCH", "LDCH"};
+static const char *const JUMPS[]  = {"J", "JEQ", "JLT", "JGT"};
+static const char *const REGS[]   = {"A", "X", "L", "B", "S", "T"};
+static const char *const PAIRS[]  = {"ADDR", "SUBR", "COMPR", "RMO", "MULR"};
+static const char *const FORMAT1[] = {"FIX", "FLOAT", "NORM"};
+static const char DIGITS36[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+template <size_t N>
+static const char *pick(const char *const (&list)[N], int i) { return list[i % N]; }
+
+SourceGenerator::SourceGenerator(const GeneratorOptions &opts)
+    : opts(opts), rngState(opts.seed) {}
+
+/********************************************************************
+*** FUNCTION SourceGenerator::next                                ***
+*********************************************************************
+*** DESCRIPTION : splitmix64 step; the generator's only source of ***
+***               randomness, so output depends on the seed alone ***
+***               (not on the standard library's distributions).  ***
+*** RETURN      : uint64_t                                        ***
+********************************************************************/
+uint64_t SourceGenerator::next() {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// kind letter + 5 base-36 digits: unique, 6 characters, never a mnemonic
+string SourceGenerator::name(char kind, long id) const {
+    string s(6, '0');
+    s[0] = kind;
+    for (int i = 5; i >= 1 && id > 0; --i, id /= 36) s[i] = DIGITS36[id % 36];
+    return s;
+}
+
+void SourceGenerator::line(const string &label, const char *op, const string &operand) {
+    if (label.empty()) buf->fill(' ', 9);
+    else {
+        buf->put(label);
+        buf->put(':');
+        buf->fill(' ', 8 - (int)label.size());
+    }
+    if (operand.empty()) buf->put(op);
+    else {
+        buf->left(op, 8);
+        buf->put(operand);
+    }
+    buf->put('\n');
+    ++lines;
+}
+
+/********************************************************************
+*** FUNCTION SourceGenerator::literal                             ***
+*********************************************************************
+*** DESCRIPTION : Picks a literal operand. Pass 1 pools a literal ***
+***               only once, so a format 3 reference may only use ***
+***               one still waiting for the next pool; format 4   ***
+***               may also reuse one pooled long ago.             ***
+*** INPUT ARGS  : near - the reference is format 3                ***
+*** RETURN      : string - =X'..' or =C'..'                       ***
+********************************************************************/
+string SourceGenerator::literal(bool near) {
+    if (!near && !pooled.empty() && chance(0.5))
+        return pooled[below((int)pooled.size())];
+    if (near) pendingNear = true;
+    if (!pending.empty() && chance(0.5))
+        return pending[below((int)pending.size())];
+
+    long id = literalCount++;
+    string lit;
+    if (id % 2 == 0) {
+        lit = "=X'000000'";
+        for (int i = 8; i >= 3; --i, id >>= 4) lit[i] = DIGITS36[id & 0xF];
+        pendingBytes += 3;
+    } else {
+        lit = "=C'" + name('Q', id) + "'";
+        pendingBytes += 6;
+    }
+    pending.push_back(lit);
+    return lit;
+}
+
+// A label of this block's data area (PC- or base-relative from its code)
+string SourceGenerator::dataOperand() {
+    int n = below(chainEnd.empty() ? 5 : 6);
+    static const char KINDS[] = "DBCXWE";
+    return n == 5 ? chainEnd : name(KINDS[n], block);
+}
+
+// Any data label so far (format 4 reaches the whole address space)
+string SourceGenerator::farOperand() {
+    if (!farLabels.empty() && chance(0.7)) return farLabels[below((int)farLabels.size())];
+    return dataOperand();
+}
+
+void SourceGenerator::ltorg() {
+    line("", "LTORG", "");
+    loc += pendingBytes;
+    for (auto &lit : pending) {
+        if (pooled.size() < REUSE_WINDOW) pooled.push_back(lit);
+        else pooled[below((int)REUSE_WINDOW)] = lit;
+    }
+    pending.clear();
+    pendingBytes = 0;
+    pendingNear = false;
+    sinceLtorg = 0;
+}
+
+/********************************************************************
+*** FUNCTION SourceGenerator::instruction                         ***
+*********************************************************************
+*** DESCRIPTION : One instruction line (plus the periodic LTORG). ***
+***               Mix: ~55% memory references (literal, format 4, ***
+***               indexed, indirect), immediates, backward jumps  ***
+***               within the block, format 2, format 1 and RSUB.  ***
+********************************************************************/
+void SourceGenerator::instruction() {
+    string label;
+    if (!firstEmitted) { label = "FIRST"; firstEmitted = true; }
+    else if (chance(opts.labelDensity)) label = name('L', labelCount++);
+    if (!label.empty()) codeLabels.push_back(label);
+
+    int r = below(100);
+    if (r < 55) {
+        bool f4 = chance(opts.format4Ratio);
+        string op, operand;
+        if (chance(opts.literalDensity)) {
+            f4 = f4 || opts.ltorgEvery == 0;
+            op = pick(LOADS, below(100));
+            operand = literal(!f4);
+        } else {
+            op = (r % 3 == 0) ? pick(STORES, below(100)) : pick(LOADS, below(100));
+            if (f4) operand = farOperand();
+            else if (op == "STCH" || op == "LDCH") operand = name('B', block) + (chance(0.5) ? ",X" : "");
+            else if (op == "LDA" && chance(0.1)) operand = "@" + name('W', block);
+            else operand = dataOperand();
+        }
+        if (f4) op = "+" + op;
+        line(label, op.c_str(), operand);
+        loc += f4 ? 4 : 3;
+    } else if (r < 65) {
+        if (chance(opts.format4Ratio)) {
+            line(label, "+LDT", "#" + to_string(4096 + below(1000000)));
+            loc += 4;
+        } else {
+            static const char *const IMM[] = {"LDA", "LDT", "LDS", "LDX", "COMP"};
+            line(label, pick(IMM, below(100)),
+                 chance(0.2) ? "#" + name('D', block) : "#" + to_string(below(4096)));
+            loc += 3;
+        }
+    } else if (r < 73) {
+        if (codeLabels.empty()) {
+            line(label, "+JSUB", "FIRST");
+            loc += 4;
+        } else {
+            line(label, pick(JUMPS, below(100)), codeLabels[below((int)codeLabels.size())]);
+            loc += 3;
+        }
+    } else if (r < 88) {
+        int kind = below(7);
+        string r1 = pick(REGS, below(100)), r2 = pick(REGS, below(100));
+        if (kind == 0) line(label, "CLEAR", r1);
+        else if (kind == 1) line(label, "TIXR", r1);
+        else line(label, pick(PAIRS, kind), r1 + "," + r2);
+        loc += 2;
+    } else if (r < 95) {
+        line(label, pick(FORMAT1, r), "");
+        loc += 1;
+    } else {
+        line(label, "RSUB", "");
+        loc += 3;
+    }
+
+    ++emitted;
+    if (opts.ltorgEvery > 0 && ++sinceLtorg >= opts.ltorgEvery) ltorg();
+}
+
+void SourceGenerator::openBlock() {
+    block = blockCount++;
+    useBase = chance(opts.baseRatio);
+    quota = 32 + below(97);
+    emitted = 0;
+    codeLabels.clear();
+    chainEnd = opts.equChain > 0 ? name('E', equCount + opts.equChain - 1) : "";
+    if (useBase) {
+        line("", "+LDB", "#" + name('D', block));
+        line("", "BASE", name('D', block));
+        loc += 4;
+    }
+}
+
+/********************************************************************
+*** FUNCTION SourceGenerator::closeBlock                          ***
+*********************************************************************
+*** DESCRIPTION : Pools literals the block's format 3 code needs, ***
+***               ends BASE (after the pad that forces base-      ***
+***               relative addressing), then writes the data area ***
+***               and its EQU chain.                              ***
+********************************************************************/
+void SourceGenerator::closeBlock() {
+    if (pendingNear) ltorg();
+    if (useBase) {
+        line("", "NOBASE", "");
+        line("", "RESB", to_string(BASE_PAD));
+        loc += BASE_PAD;
+    }
+    string d = name('D', block), w = name('W', block);
+    int resb = 16 + below(49), chars = 3 + below(6), bytes = 1 + below(3), words = 1 + below(8);
+    string text, hex;
+    for (int i = 0; i < chars; ++i) text += DIGITS36[10 + below(26)];
+    for (int i = 0; i < 2 * bytes; ++i) hex += DIGITS36[below(16)];
+    line(d, "WORD", to_string(below(100000)));
+    line(name('B', block), "RESB", to_string(resb));
+    line(name('C', block), "BYTE", "C'" + text + "'");
+    line(name('X', block), "BYTE", "X'" + hex + "'");
+    line(w, "RESW", to_string(words));
+    loc += 3 + resb + chars + bytes + 3 * words;
+
+    for (int i = 0; i < opts.equChain; ++i)
+        line(name('E', equCount + i), "EQU", i == 0 ? d : name('E', equCount + i - 1));
+    equCount += opts.equChain;
+
+    for (const string &label : {d, w}) {
+        if (farLabels.size() < REUSE_WINDOW) farLabels.push_back(label);
+        else farLabels[below((int)REUSE_WINDOW)] = label;
+    }
+}
+
+/********************************************************************
+*** FUNCTION SourceGenerator::writeProgram                        ***
+*********************************************************************
+*** DESCRIPTION : One program of at most budget lines (exactly    ***
+***               budget unless the address space filled first;   ***
+***               never fewer than the 3-line skeleton).          ***
+*** INPUT ARGS  : out, index - program number, budget - lines     ***
+*** RETURN      : long - lines written                            ***
+********************************************************************/
+long SourceGenerator::writeProgram(ostream &out, int index, long budget) {
+    buf.reset(new OutputBuffer(out));
+    lines = loc = 0;
+    labelCount = equCount = blockCount = literalCount = 0;
+    firstEmitted = false;
+    pending.clear(); pooled.clear(); farLabels.clear();
+    pendingBytes = 0; pendingNear = false; sinceLtorg = 0;
+
+    buf->put(". sicxegen program " + to_string(index) + ", seed " + to_string(opts.seed) + "\n");
+    ++lines;
+    line(name('G', index), "START", "0");
+
+    // worst-case tail of a block: pool, NOBASE + pad, data, chain; then END
+    const long tail = 1 + 2 + DATA_LINES + opts.equChain + 1;
+    bool addressFull = false;
+    while (lines + 2 + 2 + tail <= budget) {
+        if (loc + pendingBytes + BLOCK_BYTES > ADDRESS_LIMIT) { addressFull = true; break; }
+        openBlock();
+        while (emitted < quota && lines + 2 + tail <= budget) instruction();
+        closeBlock();
+    }
+    while (!addressFull && lines + 1 < budget) {
+        buf->put(".\n");
+        ++lines;
+    }
+    line("", "END", firstEmitted ? "FIRST" : "");
+    buf.reset();
+    return lines;
+}
+
+bool SourceGenerator::writeFiles(const string &prefix, vector<GeneratedFile> &files, string &err) {
+    long remaining = opts.lines;
+    int index = 0;
+    do {
+        GeneratedFile file;
+        file.path = index == 0 ? prefix + ".asm" : prefix + "-" + to_string(index) + ".asm";
+        ofstream out(file.path);
+        if (!out) { err = "cannot write " + file.path; return false; }
+        file.lines = writeProgram(out, index++, remaining);
+        out.close();
+        if (!out) { err = "write failed for " + file.path; return false; }
+        remaining -= file.lines;
+        files.push_back(file);
+    } while (remaining > 0);
+    return true;
+}
+
+bool SourceGenerator::writeStream(ostream &out, string &err) {
+    long written = writeProgram(out, 0, opts.lines);
+    if (written < opts.lines) {
+        err = to_string(opts.lines) + " lines do not fit one program's address space;"
+              " write files with -o PREFIX instead";
+        return false;
+    }
+    return true;
+}
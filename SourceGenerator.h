@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "OutputBuffer.h"
+
+/********************************************************************
+*** STRUCT GeneratorOptions                                       ***
+*********************************************************************
+*** DESCRIPTION : Shape of a synthetic SIC/XE corpus. Ratios are  ***
+***               0..1 shares; the same options and seed always   ***
+***               give the same sources.                          ***
+********************************************************************/
+struct GeneratorOptions {
+    long     lines = 1000;          // source lines in the whole corpus
+    double   labelDensity = 0.2;    // instructions that carry a label
+    double   literalDensity = 0.1;  // memory operands that are literals
+    int      ltorgEvery = 200;      // LTORG after this many instructions (0 = END only)
+    double   format4Ratio = 0.1;    // memory references in format 4
+    int      equChain = 3;          // EQU chain length per block (0 = none)
+    double   baseRatio = 0.25;      // blocks that address their data base-relative
+    uint64_t seed = 1;
+};
+
+// One generated program
+struct GeneratedFile {
+    std::string path;
+    long lines = 0;
+};
+
+/********************************************************************
+*** CLASS SourceGenerator                                         ***
+*********************************************************************
+*** DESCRIPTION : Writes valid SIC/XE programs that assemble with ***
+***               no diagnostics. Code comes in blocks: a run of  ***
+***               format 1-4 instructions (optionally under BASE) ***
+***               followed by the block's data and EQU chain, so  ***
+***               every format 3 operand stays in PC- or base-    ***
+***               relative range. Format 3 literals are always    ***
+***               pooled by an LTORG in the same block. A program ***
+***               is closed before it outgrows the 1 MB address   ***
+***               space; larger corpora continue in further       ***
+***               programs.                                       ***
+********************************************************************/
+class SourceGenerator {
+public:
+    explicit SourceGenerator(const GeneratorOptions &opts);
+
+    // Writes <prefix>.asm, then <prefix>-1.asm, <prefix>-2.asm, ... while
+    // lines remain; files lists what was written
+    bool writeFiles(const std::string &prefix, std::vector<GeneratedFile> &files,
+                    std::string &err);
+    // One program to out; fails if the line count needs more than one
+    bool writeStream(std::ostream &out, std::string &err);
+
+private:
+    long writeProgram(std::ostream &out, int index, long budget);
+    void openBlock();
+    void closeBlock();
+    void instruction();
+    void ltorg();
+    void line(const std::string &label, const char *op, const std::string &operand);
+
+    std::string name(char kind, long id) const;
+    std::string literal(bool near);
+    std::string dataOperand();
+    std::string farOperand();
+    uint64_t next();
+    int  below(int n) { return (int)(next() % (uint64_t)n); }
+    bool chance(double p) { return (double)(next() >> 11) * (1.0 / 9007199254740992.0) < p; }
+
+    GeneratorOptions opts;
+    uint64_t rngState;
+
+    // Per program
+    std::unique_ptr<OutputBuffer> buf;
+    long lines = 0;
+    long loc = 0;
+    long labelCount = 0, equCount = 0, blockCount = 0, literalCount = 0;
+    bool firstEmitted = false;
+    std::vector<std::string> pending;       // literals waiting for the next pool
+    long pendingBytes = 0;
+    bool pendingNear = false;               // a format 3 reference waits on the pool
+    int  sinceLtorg = 0;
+    std::vector<std::string> pooled;        // recent pooled literals (format 4 reuse)
+    std::vector<std::string> farLabels;     // data labels of earlier blocks
+
+    // Per block
+    long block = 0;
+    bool useBase = false;
+    int  quota = 0, emitted = 0;
+    std::vector<std::string> codeLabels;
+    std::string chainEnd;
+};
@@ -0,0 +1,194 @@
+#include "SourceLexer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+/********************************************************************
+*** FUNCTION isSpace                                              ***
+*********************************************************************
+*** DESCRIPTION : Whitespace as istringstream >> sees it in the   ***
+***               "C" locale.                                     ***
+********************************************************************/
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+/********************************************************************
+*** FUNCTION nextToken                                            ***
+*********************************************************************
+*** DESCRIPTION : Finds the next whitespace-delimited token in s  ***
+***               at or after pos.                                ***
+*** INPUT ARGS  : s, pos                                          ***
+*** OUTPUT ARGS : b, e - token bounds [b, e)                      ***
+*** RETURN      : bool - false if no token remains                ***
+********************************************************************/
+static inline bool nextToken(std::string_view s, size_t pos, size_t& b, size_t& e) {
+    while (pos < s.size() && isSpace(s[pos])) ++pos;
+    if (pos >= s.size()) return false;
+    b = pos;
+    while (pos < s.size() && !isSpace(s[pos])) ++pos;
+    e = pos;
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION LexedLine::opcodeUpper                               ***
+*********************************************************************
+*** DESCRIPTION : Uppercase opcode. Returns the original view     ***
+***               when it has no lowercase letters; otherwise     ***
+***               folds into scratch and returns a view of it.    ***
+*** IN/OUT ARGS : scratch - backing store for a folded copy       ***
+*** RETURN      : string_view - uppercase opcode                  ***
+********************************************************************/
+std::string_view LexedLine::opcodeUpper(std::string& scratch) const {
+    size_t i = 0;
+    while (i < opcode.size() && !(opcode[i] >= 'a' && opcode[i] <= 'z')) ++i;
+    if (i == opcode.size()) return opcode;
+    scratch.assign(opcode.data(), opcode.size());
+    for (; i < scratch.size(); ++i)
+        if (scratch[i] >= 'a' && scratch[i] <= 'z') scratch[i] = (char)(scratch[i] - 'a' + 'A');
+    return scratch;
+}
+
+/********************************************************************
+*** FUNCTION lexLine                                              ***
+*********************************************************************
+*** DESCRIPTION : Splits a source line into views for label,      ***
+***               opcode, operand and comment (see header).       ***
+*** INPUT ARGS  : line - one source line without its newline      ***
+*** OUTPUT ARGS : out  - lexed fields                             ***
+*** IN/OUT ARGS : joinScratch - storage for a rewritten operand   ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void lexLine(std::string_view line, LexedLine& out, std::string& joinScratch) {
+    out = LexedLine();
+
+    // Full-line comment
+    if (line.empty() || line[0] == '.') {
+        out.isComment = true;
+        out.comment = line;
+        return;
+    }
+
+    // Inline comment
+    size_t commentPos = line.find('.');
+    std::string_view code = line.substr(0, commentPos);
+    if (commentPos != std::string_view::npos) out.comment = line.substr(commentPos);
+
+    size_t b = 0, e = 0;
+    if (!nextToken(code, 0, b, e)) {
+        out.isComment = true;
+        return;
+    }
+
+    // Label starts in column 0 (no leading whitespace in original line)
+    bool hasLabel = line[0] != ' ' && line[0] != '\t';
+    if (hasLabel) {
+        out.label = code.substr(b, e - b);
+        if (!nextToken(code, e, b, e)) return;
+    }
+    out.opcode = code.substr(b, e - b);
+    if (!nextToken(code, e, b, e)) return;
+
+    // Operand: a single token is returned in place. Extra tokens are
+    // joined the way parseLine always has: the first one glued straight
+    // on ("BUF ,X" -> "BUF,X"), later ones separated by one space.
+    out.operand = code.substr(b, e - b);
+    size_t tb, te;
+    if (!nextToken(code, e, tb, te)) return;
+    joinScratch.assign(out.operand.data(), out.operand.size());
+    joinScratch.append(code.data() + tb, te - tb);
+    while (nextToken(code, te, tb, te)) {
+        joinScratch += ' ';
+        joinScratch.append(code.data() + tb, te - tb);
+    }
+    out.operand = joinScratch;
+}
+
+/********************************************************************
+*** FUNCTION SourceLexer::open                                    ***
+*********************************************************************
+*** DESCRIPTION : Maps a source file and rewinds to its start.    ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : err - reason on failure                         ***
+*** RETURN      : bool - true if mapped                           ***
+********************************************************************/
+bool SourceLexer::open(const std::string& path, std::string& err) {
+    if (!file.open(path, err)) return false;
+    attach(std::string_view(file.data(), file.size()));
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION SourceLexer::attach                                  ***
+*********************************************************************
+*** DESCRIPTION : Lexes a caller-owned buffer instead of a file.  ***
+*** INPUT ARGS  : buf      - source text (must outlive the lexer) ***
+***               lineBase - source lines before buf (a control   ***
+***                          section of a larger file)            ***
+*** RETURN      : void                                             ***
+********************************************************************/
+void SourceLexer::attach(std::string_view buf, int lineBase) {
+    text = buf;
+    pos = 0;
+    lineNo = lineBase;
+}
+
+void SourceLexer::readFrom(int fd) {
+    streamFd = fd;
+    streamEof = false;
+    streamBuf.clear();
+    streamErr.clear();
+    attach(std::string_view());
+}
+
+/********************************************************************
+*** FUNCTION SourceLexer::fillLine                                ***
+*********************************************************************
+*** DESCRIPTION : readFrom mode: reads until the buffer holds a   ***
+***               complete line after pos, or the input ends.     ***
+***               Already lexed text is dropped first, which is   ***
+***               why views only last until the next lex call.    ***
+********************************************************************/
+void SourceLexer::fillLine() {
+    const size_t CHUNK = 64 * 1024;
+    size_t scanned = pos;
+    while (!streamEof && streamBuf.find('\n', scanned) == std::string::npos) {
+        if (pos > 0) {
+            streamBuf.erase(0, pos);
+            pos = 0;
+        }
+        size_t have = streamBuf.size();
+        scanned = have;
+        streamBuf.resize(have + CHUNK);
+        ssize_t n = ::read(streamFd, &streamBuf[have], CHUNK);
+        streamBuf.resize(have + std::max<ssize_t>(n, 0));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            streamEof = true;
+            if (n < 0) streamErr = std::string("read: ") + std::strerror(errno);
+        }
+    }
+    text = streamBuf;
+}
+
+/********************************************************************
+*** FUNCTION SourceLexer::next                                    ***
+*********************************************************************
+*** DESCRIPTION : Lexes the next line. A final line without a     ***
+***               newline still counts; a trailing newline does   ***
+***               not start an extra empty line.                  ***
+*** OUTPUT ARGS : out - lexed fields                              ***
+*** RETURN      : bool - false at end of buffer                   ***
+********************************************************************/
+bool SourceLexer::next(LexedLine& out) {
+    if (streamFd >= 0) fillLine();
+    if (pos >= text.size()) return false;
+    size_t nl = text.find('\n', pos);
+    size_t end = (nl == std::string_view::npos) ? text.size() : nl;
+    lexLine(text.substr(pos, end - pos), out, joinScratch);
+    pos = (nl == std::string_view::npos) ? text.size() : nl + 1;
+    ++lineNo;
+    return true;
+}
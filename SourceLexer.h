@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "MappedFile.h"
+
+/********************************************************************
+*** STRUCT LexedLine                                              ***
+*********************************************************************
+*** DESCRIPTION : One source line split into label, opcode,       ***
+***               operand and comment as views into the source    ***
+***               buffer (no copies). The opcode is left in its   ***
+***               original case; opcodeUpper() folds it only when ***
+***               it actually contains lowercase letters.         ***
+***               Views are valid until the next lex call.        ***
+********************************************************************/
+struct LexedLine {
+    std::string_view label;
+    std::string_view opcode;
+    std::string_view operand;
+    std::string_view comment;
+    bool isComment = false;
+
+    std::string_view opcodeUpper(std::string& scratch) const;
+};
+
+// Split one line (no trailing '\n') with the same rules as parseLine:
+// '.' in column 0 or an empty line is a comment, a label must start in
+// column 0, and tokens after the operand are folded into it. joinScratch
+// backs the operand only when there are such extra tokens.
+void lexLine(std::string_view line, LexedLine& out, std::string& joinScratch);
+
+/********************************************************************
+*** CLASS SourceLexer                                             ***
+*********************************************************************
+*** DESCRIPTION : Walks a source buffer line by line (getline     ***
+***               semantics) and lexes each line in place. The    ***
+***               buffer is either an mmap'd .asm file, text      ***
+***               owned by the caller, or a pipe read as the      ***
+***               lines arrive (readFrom).                        ***
+********************************************************************/
+class SourceLexer {
+public:
+    bool open(const std::string& path, std::string& err);
+    // lineBase: lines of the file before text (line numbers continue
+    // from it)
+    void attach(std::string_view text, int lineBase = 0);
+    // Reads the source from fd (e.g. stdin) as it arrives: each line is
+    // lexed as soon as it is complete, so the producer and Pass 1 overlap.
+    // buffer() then holds only what has been read and not yet lexed.
+    void readFrom(int fd);
+    bool streaming() const { return streamFd >= 0; }
+    // Read failure in readFrom mode ("" if none); the source ends there
+    const std::string& readError() const { return streamErr; }
+
+    bool next(LexedLine& out);          // false once the buffer is used up
+    int  lineNumber() const { return lineNo; }
+    std::string_view buffer() const { return text; }
+
+private:
+    void fillLine();                    // readFrom: a whole line, or EOF
+
+    MappedFile file;
+    std::string_view text;
+    size_t pos = 0;
+    int lineNo = 0;
+    std::string joinScratch;
+    int streamFd = -1;
+    bool streamEof = false;
+    std::string streamBuf, streamErr;
+};
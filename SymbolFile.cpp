@@ -0,0 +1,292 @@
+#include "SymbolFile.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+#include "Intermediate.h"
+
+using namespace std;
+
+/********************************************************************
+*** FUNCTION symbolFileFor                                        ***
+*********************************************************************
+*** DESCRIPTION : Derives the .sym path from a source, .int or    ***
+***               .intb path by replacing the extension.          ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : none                                            ***
+*** RETURN      : string - sidecar path                           ***
+********************************************************************/
+string symbolFileFor(const string &path) {
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return path + ".sym";
+    return path.substr(0, dot) + ".sym";
+}
+
+/********************************************************************
+*** FUNCTION addSymbol / addLiteral                               ***
+*********************************************************************
+*** DESCRIPTION : Enter one Pass 1 table entry into the Pass 2    ***
+***               program tables (symbols list, symaddr, absolutes,***
+***               litaddr).                                       ***
+********************************************************************/
+static void addSymbol(Pass2Program &prog, SymbolTable::Record rec) {
+    prog.symaddr[symbolKey(rec.name)] = rec.value;
+    if (!rec.rflag) prog.absolutes.insert(symbolKey(rec.name));
+    prog.symbols.push_back(std::move(rec));
+}
+
+static void addLiteral(Pass2Program &prog, const string &literal, int address) {
+    prog.litaddr[literal] = address;
+}
+
+/********************************************************************
+*** FUNCTION appendSymbolBlock                                    ***
+*********************************************************************
+*** DESCRIPTION : Renders one program's (or control section's)    ***
+***               symbol and literal tables as a .sym block:      ***
+***               header, fixed-size entries, then its strings.   ***
+*** INPUT ARGS  : symtab, littab                                  ***
+***               sectionLength - length of a section a later     ***
+***                               CSECT ends, else -1             ***
+*** IN/OUT ARGS : out - block appended                            ***
+*** RETURN      : void                                            ***
+********************************************************************/
+static void appendSymbolBlock(const SymbolTable &symtab, const LiteralTable &littab,
+                              int sectionLength, string &out) {
+    string strings;
+    auto store = [&](const string &s) {
+        symf::StrRef ref;
+        ref.offset = (uint32_t)strings.size();
+        ref.length = (uint32_t)s.size();
+        strings += s;
+        return ref;
+    };
+
+    vector<symf::Symbol> symbols;
+    for (const auto &rec : symtab.getSymbols()) {
+        symf::Symbol sym;
+        memset(&sym, 0, sizeof(sym));
+        sym.name  = store(rec.name);
+        sym.value = rec.value;
+        sym.rflag = rec.rflag ? 1 : 0;
+        sym.iflag = rec.iflag ? 1 : 0;
+        sym.mflag = rec.mflag ? 1 : 0;
+        symbols.push_back(sym);
+    }
+    vector<symf::Literal> literals;
+    for (const auto &info : littab.getLiterals()) {
+        symf::Literal lit;
+        memset(&lit, 0, sizeof(lit));
+        lit.literal = store(info.literal);
+        lit.length  = info.length;
+        lit.address = info.address;
+        literals.push_back(lit);
+    }
+
+    symf::Header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, symf::MAGIC, sizeof(hdr.magic));
+    hdr.version      = symf::VERSION;
+    hdr.symbolCount  = (uint32_t)symbols.size();
+    hdr.literalCount = (uint32_t)literals.size();
+    hdr.stringBytes  = (uint32_t)strings.size();
+    hdr.sectionLength = sectionLength;
+
+    out.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    out.append(reinterpret_cast<const char*>(symbols.data()), symbols.size() * sizeof(symf::Symbol));
+    out.append(reinterpret_cast<const char*>(literals.data()), literals.size() * sizeof(symf::Literal));
+    out += strings;
+}
+
+static bool writeBlocks(const string &path, const string &blocks, string &err) {
+    ofstream out(path, ios::binary);
+    if (!out) { err = "cannot open " + path + " for writing"; return false; }
+    out.write(blocks.data(), blocks.size());
+    if (!out) { err = "write failed for " + path; return false; }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION writeSymbolFile                                      ***
+*********************************************************************
+*** DESCRIPTION : Writes the final Pass 1 symbol and literal      ***
+***               tables as a fixed-layout .sym sidecar; with     ***
+***               control sections, one block per section in      ***
+***               source order.                                   ***
+*** INPUT ARGS  : path, symtab, littab (or sections)              ***
+*** OUTPUT ARGS : err - reason on failure                         ***
+*** RETURN      : bool - true if written                          ***
+********************************************************************/
+bool writeSymbolFile(const string &path, const SymbolTable &symtab,
+                     const LiteralTable &littab, string &err) {
+    string block;
+    appendSymbolBlock(symtab, littab, -1, block);
+    return writeBlocks(path, block, err);
+}
+
+bool writeSymbolFile(const string &path, const Pass1Sections &sections, string &err) {
+    string blocks;
+    for (size_t k = 0; k < sections.size(); ++k) {
+        const Pass1Section &s = *sections[k];
+        appendSymbolBlock(s.symtab, s.littab,
+                          k + 1 < sections.size() ? s.result.programLength : -1, blocks);
+    }
+    return writeBlocks(path, blocks, err);
+}
+
+/********************************************************************
+*** FUNCTION loadSymbolBlock                                      ***
+*********************************************************************
+*** DESCRIPTION : Validates the .sym block at the start of data   ***
+***               and loads its tables into one program state.    ***
+*** INPUT ARGS  : path - for messages                             ***
+***               data, size - mapped bytes from the block on     ***
+*** OUTPUT ARGS : prog, err                                       ***
+***               used - bytes the block takes                    ***
+*** RETURN      : bool - true if loaded                           ***
+********************************************************************/
+static bool loadSymbolBlock(const string &path, const char *data, size_t size,
+                            Pass2Program &prog, size_t &used, string &err) {
+    if (size < sizeof(symf::Header)) {
+        err = path + ": too small to be a .sym file";
+        return false;
+    }
+    symf::Header hdr;
+    memcpy(&hdr, data, sizeof(hdr));
+    if (memcmp(hdr.magic, symf::MAGIC, sizeof(hdr.magic)) != 0) {
+        err = path + ": not a .sym file (bad magic)";
+        return false;
+    }
+    if (hdr.version != symf::VERSION) {
+        ostringstream oss;
+        oss << path << ": stale .sym (version " << hdr.version
+            << ", expected " << symf::VERSION << ") - rerun Pass1";
+        err = oss.str();
+        return false;
+    }
+    uint64_t tables = (uint64_t)hdr.symbolCount * sizeof(symf::Symbol)
+                    + (uint64_t)hdr.literalCount * sizeof(symf::Literal);
+    if (sizeof(symf::Header) + tables + hdr.stringBytes > size) {
+        err = path + ": truncated or corrupt .sym";
+        return false;
+    }
+    used = sizeof(symf::Header) + tables + hdr.stringBytes;
+    prog.sectionLength = hdr.sectionLength;
+    const char *base = data + sizeof(symf::Header);
+    const char *strings = base + tables;
+    auto text = [&](const symf::StrRef &ref, string &out) {
+        if ((uint64_t)ref.offset + ref.length > hdr.stringBytes) return false;
+        out.assign(strings + ref.offset, ref.length);
+        return true;
+    };
+
+    prog.symbols.reserve(hdr.symbolCount);
+    for (uint32_t i = 0; i < hdr.symbolCount; ++i) {
+        symf::Symbol sym;
+        memcpy(&sym, base + (size_t)i * sizeof(sym), sizeof(sym));
+        SymbolTable::Record rec;
+        if (!text(sym.name, rec.name)) {
+            err = path + ": string reference out of range";
+            return false;
+        }
+        rec.value = sym.value;
+        rec.rflag = sym.rflag != 0;
+        rec.iflag = sym.iflag != 0;
+        rec.mflag = sym.mflag != 0;
+        addSymbol(prog, std::move(rec));
+    }
+    const char *litBase = base + (size_t)hdr.symbolCount * sizeof(symf::Symbol);
+    for (uint32_t i = 0; i < hdr.literalCount; ++i) {
+        symf::Literal lit;
+        memcpy(&lit, litBase + (size_t)i * sizeof(lit), sizeof(lit));
+        string literal;
+        if (!text(lit.literal, literal)) {
+            err = path + ": string reference out of range";
+            return false;
+        }
+        addLiteral(prog, literal, lit.address);
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION loadSymbolFile                                       ***
+*********************************************************************
+*** DESCRIPTION : Maps a .sym, validates it, and loads its tables ***
+***               into the Pass 2 program state: a single block,  ***
+***               or block k into control section k.              ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : prog (or sections), err                         ***
+*** RETURN      : bool - true if loaded                           ***
+********************************************************************/
+bool loadSymbolFile(const string &path, Pass2Program &prog, string &err) {
+    MappedFile map;
+    if (!map.open(path, err)) {
+        err += " - rerun Pass1 to produce the symbol table";
+        return false;
+    }
+    size_t used = 0;
+    if (!loadSymbolBlock(path, map.data(), map.size(), prog, used, err)) return false;
+    if (used != map.size()) {
+        err = path + ": has several control sections (not supported with --stream)";
+        return false;
+    }
+    return true;
+}
+
+bool loadSymbolFile(const string &path, vector<Pass2Section> &sections, string &err) {
+    MappedFile map;
+    if (!map.open(path, err)) {
+        err += " - rerun Pass1 to produce the symbol table";
+        return false;
+    }
+    size_t pos = 0, blocks = 0;
+    for (; pos < map.size() || blocks == 0; ++blocks) {
+        Pass2Program scratch;
+        Pass2Program &prog = blocks < sections.size() ? sections[blocks].prog : scratch;
+        size_t used = 0;
+        if (!loadSymbolBlock(path, map.data() + pos, map.size() - pos, prog, used, err))
+            return false;
+        pos += used;
+    }
+    if (blocks != sections.size()) {
+        err = path + ": " + to_string(blocks) + " control section(s), the intermediate file has " +
+              to_string(sections.size()) + " - rerun Pass1";
+        return false;
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION loadProgramTables                                    ***
+*********************************************************************
+*** DESCRIPTION : In-memory equivalent of writeSymbolFile followed ***
+***               by loadSymbolFile, for the fused driver.        ***
+*** INPUT ARGS  : symtab, littab                                  ***
+*** OUTPUT ARGS : prog                                            ***
+*** RETURN      : void                                            ***
+********************************************************************/
+void loadProgramTables(const SymbolTable &symtab, const LiteralTable &littab,
+                       Pass2Program &prog) {
+    for (auto &rec : symtab.getSymbols()) addSymbol(prog, std::move(rec));
+    for (const auto &info : littab.getLiterals()) addLiteral(prog, info.literal, info.address);
+}
+
+void loadProgramSections(Pass1Sections &in, vector<Pass2Section> &out) {
+    out.clear();
+    out.resize(in.size());
+    for (size_t k = 0; k < in.size(); ++k) {
+        Pass1Section &p1 = *in[k];
+        out[k].lines.reserve(p1.result.rows.size());
+        for (auto &row : p1.result.rows) {
+            Line L;
+            if (rowToLine(std::move(row), L)) out[k].lines.push_back(std::move(L));
+        }
+        loadProgramTables(p1.symtab, p1.littab, out[k].prog);
+        if (k + 1 < in.size()) out[k].prog.sectionLength = p1.result.programLength;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "SymbolTable.h"
+#include "LiteralTable.h"
+#include "Pass1Core.h"
+#include "Pass2Core.h"
+
+/********************************************************************
+*** Symbol sidecar (.sym) layout                                  ***
+*********************************************************************
+*** Header | Symbol[symbolCount] | Literal[literalCount] | strings ***
+*** Written by Pass 1 next to its intermediate file so Pass 2 can  ***
+*** take the final symbol and literal tables as-is. Native-endian  ***
+*** like the .intb; strings are referenced by offset + length.     ***
+*** A program with control sections has one such block per section,***
+*** back to back in source order; each block but the last carries  ***
+*** its section's length, since no END row gives it.               ***
+********************************************************************/
+namespace symf {
+
+const char     MAGIC[4] = {'S', 'X', 'S', 'Y'};
+const uint32_t VERSION  = 2;
+
+struct Header {
+    char     magic[4];
+    uint32_t version;
+    uint32_t symbolCount;
+    uint32_t literalCount;
+    uint32_t stringBytes;
+    int32_t  sectionLength;   // a section a later CSECT ends; -1 otherwise
+};
+
+struct StrRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Symbol {
+    StrRef  name;
+    int32_t value;
+    uint8_t rflag;
+    uint8_t iflag;
+    uint8_t mflag;
+    uint8_t reserved;
+};
+
+struct Literal {
+    StrRef  literal;
+    int32_t length;    // bytes
+    int32_t address;
+};
+
+static_assert(sizeof(Header) == 24, "symf::Header layout changed - bump VERSION");
+static_assert(sizeof(Symbol) == 16, "symf::Symbol layout changed - bump VERSION");
+static_assert(sizeof(Literal) == 16, "symf::Literal layout changed - bump VERSION");
+
+} // namespace symf
+
+// Sidecar path for an intermediate or source path: same base name, ".sym"
+std::string symbolFileFor(const std::string &path);
+
+// .sym output (Pass 1) and mmap'd input (Pass 2); false + err on failure
+bool writeSymbolFile(const std::string &path, const SymbolTable &symtab,
+                     const LiteralTable &littab, std::string &err);
+bool writeSymbolFile(const std::string &path, const Pass1Sections &sections, std::string &err);
+bool loadSymbolFile(const std::string &path, Pass2Program &prog, std::string &err);
+// Block k into sections[k] (from splitListingSections); the counts must match
+bool loadSymbolFile(const std::string &path, std::vector<Pass2Section> &sections,
+                    std::string &err);
+
+// Same tables handed over in memory (fused driver)
+void loadProgramTables(const SymbolTable &symtab, const LiteralTable &littab,
+                       Pass2Program &prog);
+// Every section's rows (moved) as listing lines, with its tables
+void loadProgramSections(Pass1Sections &in, std::vector<Pass2Section> &out);
@@ -2,37 +2,140 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
 #include <vector>
-#include <map>
 #include <sstream>
 
 class SymbolTableImpl {
 public:
     struct Symbol {
-        int value = 0;
-        std::string valueStr;
+        uint64_t key = 0;     // packed 6-char name (see packKey)
+        int  value = 0;
         bool rflag = true;
         bool iflag = true;
         bool mflag = false;
+        bool equ   = false;   // EQU result: VALUE column shows the low 16 bits
     };
-    std::map<std::string, Symbol> symbols;
+    struct Slot {
+        uint64_t key = 0;     // 0 = empty
+        int index = -1;       // into symbols
+    };
+    std::vector<Symbol> symbols;   // records, contiguous, in insertion order
+    std::vector<Slot>   slots;     // open addressing, linear probing, power of 2
+    size_t mask = 0;
+
+    SymbolTableImpl() : slots(64), mask(63) {}
+    int  find(uint64_t key) const;
+    int  insert(uint64_t key, bool &inserted);
+    void grow();
 };
 
 /********************************************************************
-*** FUNCTION key6                                                 ***
+*** FUNCTION packKey                                              ***
+*********************************************************************
+*** DESCRIPTION : Packs a symbol name, truncated to 6 characters, ***
+***               into one integer key: 6 name bytes in bits 0-47 ***
+***               and (length + 1) above them, so no name packs   ***
+***               to 0 (the empty-slot marker).                   ***
+*** INPUT ARGS  : s - symbol name                                 ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : uint64_t - packed key                           ***
+********************************************************************/
+static inline uint64_t packKey(std::string_view s) {
+    size_t n = s.size() < 6 ? s.size() : 6;
+    uint64_t key = uint64_t(n + 1) << 48;
+    for (size_t i = 0; i < n; ++i) key |= uint64_t((unsigned char)s[i]) << (8 * i);
+    return key;
+}
+
+/********************************************************************
+*** FUNCTION unpackKey                                            ***
 *********************************************************************
-*** DESCRIPTION : Truncates a symbol name to 6 characters for     ***
-***               standardized key lookups.                       ***
-*** INPUT ARGS  : s - symbol name string                          ***
+*** DESCRIPTION : Recovers the (truncated) symbol name from a key.***
+*** INPUT ARGS  : key - packed key                                ***
 *** OUTPUT ARGS : none                                            ***
 *** IN/OUT ARGS : none                                            ***
-*** RETURN      : string - truncated (max 6 chars) copy           ***
+*** RETURN      : string - symbol name                            ***
 ********************************************************************/
-static std::string key6(std::string s) {
-    if (s.size() > 6) s = s.substr(0, 6);
+static std::string unpackKey(uint64_t key) {
+    size_t n = size_t(key >> 48) - 1;
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; ++i) s[i] = (char)((key >> (8 * i)) & 0xFF);
     return s;
 }
 
+/********************************************************************
+*** FUNCTION slotHash                                             ***
+*********************************************************************
+*** DESCRIPTION : Spreads a packed key over the slot array.       ***
+********************************************************************/
+static inline size_t slotHash(uint64_t key) {
+    key ^= key >> 29;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 32;
+    return (size_t)key;
+}
+
+/********************************************************************
+*** FUNCTION SymbolTableImpl::find                                ***
+*********************************************************************
+*** DESCRIPTION : Probes for a key.                               ***
+*** INPUT ARGS  : key - packed key                                ***
+*** RETURN      : int - record index; -1 if absent                ***
+********************************************************************/
+int SymbolTableImpl::find(uint64_t key) const {
+    for (size_t i = slotHash(key) & mask; ; i = (i + 1) & mask) {
+        const Slot &s = slots[i];
+        if (s.key == key) return s.index;
+        if (s.key == 0) return -1;
+    }
+}
+
+/********************************************************************
+*** FUNCTION SymbolTableImpl::insert                              ***
+*********************************************************************
+*** DESCRIPTION : Finds a key or claims a slot and a default      ***
+***               record for it, growing at 50% load.             ***
+*** INPUT ARGS  : key - packed key                                ***
+*** OUTPUT ARGS : inserted - true if the record is new            ***
+*** RETURN      : int - record index                              ***
+********************************************************************/
+int SymbolTableImpl::insert(uint64_t key, bool &inserted) {
+    if ((symbols.size() + 1) * 2 > slots.size()) grow();
+    for (size_t i = slotHash(key) & mask; ; i = (i + 1) & mask) {
+        Slot &s = slots[i];
+        if (s.key == key) { inserted = false; return s.index; }
+        if (s.key == 0) {
+            s.key = key;
+            s.index = (int)symbols.size();
+            symbols.emplace_back();
+            symbols.back().key = key;
+            inserted = true;
+            return s.index;
+        }
+    }
+}
+
+/********************************************************************
+*** FUNCTION SymbolTableImpl::grow                                ***
+*********************************************************************
+*** DESCRIPTION : Doubles the slot array and re-seats every key.  ***
+********************************************************************/
+void SymbolTableImpl::grow() {
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+    mask = slots.size() - 1;
+    for (const Slot &o : old) {
+        if (o.key == 0) continue;
+        size_t i = slotHash(o.key) & mask;
+        while (slots[i].key != 0) i = (i + 1) & mask;
+        slots[i] = o;
+    }
+}
+
 /********************************************************************
 *** FUNCTION SymbolTable (constructor)                            ***
 *********************************************************************
@@ -73,85 +176,73 @@ SymbolTable::~SymbolTable() {
 *** IN/OUT ARGS : none                                            ***
 *** RETURN      : bool - false if duplicate; true if inserted     ***
 ********************************************************************/
-bool SymbolTable::insert(const std::string& name, int value,
+bool SymbolTable::insert(std::string_view name, int value,
                          bool rflag, bool iflag, bool mflag) {
-    std::string key = key6(name);
-    if (pimpl->symbols.find(key) != pimpl->symbols.end()) return false;
-    SymbolTableImpl::Symbol sym;
-    sym.value = value;
-    sym.valueStr.clear();
-    sym.rflag = rflag;
-    sym.iflag = iflag;
-    sym.mflag = mflag;
-    pimpl->symbols[key] = sym;
-    return true;
+    bool inserted = false;
+    insertOrGet(name, value, rflag, iflag, mflag, &inserted);
+    return inserted;
 }
 
 /********************************************************************
-*** FUNCTION insertWithValueString                                ***
+*** FUNCTION find                                                 ***
 *********************************************************************
-*** DESCRIPTION : Inserts a symbol with an explicit printable     ***
-***               VALUE string (e.g., "200" or "F"). Useful for   ***
-***               EQU or character constants. Truncates to 6      ***
-***               chars; rejects duplicates.                      ***
-*** INPUT ARGS  : name     - symbol name                          ***
-***               valueStr - printable value string               ***
-***               rflag    - relative flag (default true)         ***
-***               iflag    - interpretation flag (default true)   ***
-***               mflag    - modification flag (default false)    ***
+*** DESCRIPTION : Looks a symbol up once and returns a handle for ***
+***               later updates.                                  ***
+*** INPUT ARGS  : name - symbol name                              ***
 *** OUTPUT ARGS : none                                            ***
 *** IN/OUT ARGS : none                                            ***
-*** RETURN      : bool - false if duplicate; true if inserted     ***
+*** RETURN      : Handle - false-y if not found                   ***
 ********************************************************************/
-bool SymbolTable::insertWithValueString(const std::string& name, const std::string& valueStr,
-                                        bool rflag, bool iflag, bool mflag) {
-    std::string key = key6(name);
-    if (pimpl->symbols.find(key) != pimpl->symbols.end()) return false;
-    SymbolTableImpl::Symbol sym;
-    sym.value = 0;
-    sym.valueStr = valueStr;
-    sym.rflag = rflag;
-    sym.iflag = iflag;
-    sym.mflag = mflag;
-    pimpl->symbols[key] = sym;
-    return true;
+SymbolTable::Handle SymbolTable::find(std::string_view name) const {
+    Handle h;
+    h.index = pimpl->find(packKey(name));
+    return h;
 }
 
 /********************************************************************
-*** FUNCTION setMFlag                                             ***
+*** FUNCTION insertOrGet                                          ***
 *********************************************************************
-*** DESCRIPTION : Sets the MFLAG for an existing symbol (e.g.,    ***
-***               detected by format-4 reference).                ***
-*** INPUT ARGS  : name  - symbol name                             ***
-***               mflag - new MFLAG value                         ***
-*** OUTPUT ARGS : none                                            ***
+*** DESCRIPTION : Inserts a symbol (value and flags as in insert) ***
+***               or, if it already exists, leaves it unchanged.  ***
+***               Either way returns its handle, so callers can   ***
+***               follow up without a second search.              ***
+*** INPUT ARGS  : name, value, rflag, iflag, mflag                ***
+*** OUTPUT ARGS : inserted - (optional) true if newly inserted    ***
 *** IN/OUT ARGS : none                                            ***
-*** RETURN      : bool - false if symbol not found                ***
+*** RETURN      : Handle - the symbol's handle                    ***
 ********************************************************************/
-bool SymbolTable::setMFlag(const std::string& name, bool mflag) {
-    std::string key = key6(name);
-    auto it = pimpl->symbols.find(key);
-    if (it == pimpl->symbols.end()) return false;
-    it->second.mflag = mflag;
-    return true;
+SymbolTable::Handle SymbolTable::insertOrGet(std::string_view name, int value,
+                                             bool rflag, bool iflag, bool mflag,
+                                             bool* inserted) {
+    bool isNew = false;
+    Handle h;
+    h.index = pimpl->insert(packKey(name), isNew);
+    if (isNew) {
+        SymbolTableImpl::Symbol &sym = pimpl->symbols[h.index];
+        sym.value = value;
+        sym.rflag = rflag;
+        sym.iflag = iflag;
+        sym.mflag = mflag;
+    }
+    if (inserted) *inserted = isNew;
+    return h;
 }
 
 /********************************************************************
-*** FUNCTION setValueString                                       ***
+*** FUNCTION setMFlag                                             ***
 *********************************************************************
-*** DESCRIPTION : Overrides the printable VALUE string for an     ***
-***               existing symbol (useful for EQU printing).      ***
-*** INPUT ARGS  : name     - symbol name                          ***
-***               valueStr - new printable value string           ***
+*** DESCRIPTION : Sets the MFLAG for an existing symbol (e.g.,    ***
+***               detected by format-4 reference).                ***
+*** INPUT ARGS  : name  - symbol name                             ***
+***               mflag - new MFLAG value                         ***
 *** OUTPUT ARGS : none                                            ***
 *** IN/OUT ARGS : none                                            ***
 *** RETURN      : bool - false if symbol not found                ***
 ********************************************************************/
-bool SymbolTable::setValueString(const std::string& name, const std::string& valueStr) {
-    std::string key = key6(name);
-    auto it = pimpl->symbols.find(key);
-    if (it == pimpl->symbols.end()) return false;
-    it->second.valueStr = valueStr;
+bool SymbolTable::setMFlag(std::string_view name, bool mflag) {
+    Handle h = find(name);
+    if (!h) return false;
+    setMFlag(h, mflag);
     return true;
 }
 
@@ -166,11 +257,10 @@ bool SymbolTable::setValueString(const std::string& name, const std::string& val
 *** IN/OUT ARGS : none                                            ***
 *** RETURN      : bool - false if symbol not found                ***
 ********************************************************************/
-bool SymbolTable::setValueInt(const std::string& name, int value) {
-    std::string key = key6(name);
-    auto it = pimpl->symbols.find(key);
-    if (it == pimpl->symbols.end()) return false;
-    it->second.value = value;
+bool SymbolTable::setValueInt(std::string_view name, int value) {
+    Handle h = find(name);
+    if (!h) return false;
+    setValueInt(h, value);
     return true;
 }
 
@@ -187,16 +277,57 @@ bool SymbolTable::setValueInt(const std::string& name, int value) {
 *** IN/OUT ARGS : none                                            ***
 *** RETURN      : bool - false if symbol not found                ***
 ********************************************************************/
-bool SymbolTable::setFlags(const std::string& name, bool rflag, bool iflag, bool mflag) {
-    std::string key = key6(name);
-    auto it = pimpl->symbols.find(key);
-    if (it == pimpl->symbols.end()) return false;
-    it->second.rflag = rflag;
-    it->second.iflag = iflag;
-    it->second.mflag = mflag;
+bool SymbolTable::setFlags(std::string_view name, bool rflag, bool iflag, bool mflag) {
+    Handle h = find(name);
+    if (!h) return false;
+    setFlags(h, rflag, iflag, mflag);
     return true;
 }
 
+/********************************************************************
+*** FUNCTION setMFlag / setValueInt / setFlags (by handle)        ***
+*********************************************************************
+*** DESCRIPTION : Same updates as the name-based setters, applied ***
+***               to a symbol already located by find() or        ***
+***               insertOrGet(). The handle must be valid.        ***
+********************************************************************/
+void SymbolTable::setMFlag(Handle h, bool mflag) {
+    pimpl->symbols[h.index].mflag = mflag;
+}
+
+void SymbolTable::setValueInt(Handle h, int value) {
+    pimpl->symbols[h.index].value = value;
+}
+
+void SymbolTable::setFlags(Handle h, bool rflag, bool iflag, bool mflag) {
+    SymbolTableImpl::Symbol &sym = pimpl->symbols[h.index];
+    sym.rflag = rflag;
+    sym.iflag = iflag;
+    sym.mflag = mflag;
+}
+
+/********************************************************************
+*** FUNCTION setEquValue                                          ***
+*********************************************************************
+*** DESCRIPTION : Records an EQU result: value, RFLAG, IFLAG=1,   ***
+***               MFLAG=0. display() prints an EQU value as its   ***
+***               low 16 bits in hex.                             ***
+*** INPUT ARGS  : h     - symbol handle                           ***
+***               value - evaluated EQU value                     ***
+***               rflag - relative flag of the expression         ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : void                                            ***
+********************************************************************/
+void SymbolTable::setEquValue(Handle h, int value, bool rflag) {
+    SymbolTableImpl::Symbol &sym = pimpl->symbols[h.index];
+    sym.value = value;
+    sym.rflag = rflag;
+    sym.iflag = true;
+    sym.mflag = false;
+    sym.equ   = true;
+}
+
 /********************************************************************
 *** FUNCTION exists                                               ***
 *********************************************************************
@@ -206,8 +337,8 @@ bool SymbolTable::setFlags(const std::string& name, bool rflag, bool iflag, bool
 *** IN/OUT ARGS : none                                            ***
 *** RETURN      : bool - true if present; false otherwise         ***
 ********************************************************************/
-bool SymbolTable::exists(const std::string& name) const {
-    return pimpl->symbols.find(key6(name)) != pimpl->symbols.end();
+bool SymbolTable::exists(std::string_view name) const {
+    return (bool)find(name);
 }
 
 /********************************************************************
@@ -220,9 +351,9 @@ bool SymbolTable::exists(const std::string& name) const {
 *** IN/OUT ARGS : none                                            ***
 *** RETURN      : int - numeric value; -1 if not found            ***
 ********************************************************************/
-int SymbolTable::getAddress(const std::string& name) const {
-    auto it = pimpl->symbols.find(key6(name));
-    if (it != pimpl->symbols.end()) return it->second.value;
+int SymbolTable::getAddress(std::string_view name) const {
+    Handle h = find(name);
+    if (h) return pimpl->symbols[h.index].value;
     return -1;
 }
 
@@ -237,54 +368,70 @@ int SymbolTable::getAddress(const std::string& name) const {
 *** RETURN      : bool - true if relative; false if absolute or   ***
 ***               not found                                       ***
 ********************************************************************/
-bool SymbolTable::isRelative(const std::string& name) const {
-    auto it = pimpl->symbols.find(key6(name));
-    if (it != pimpl->symbols.end()) return it->second.rflag;
+bool SymbolTable::isRelative(std::string_view name) const {
+    Handle h = find(name);
+    if (h) return pimpl->symbols[h.index].rflag;
     return false;
 }
 
 /********************************************************************
 *** FUNCTION display                                              ***
 *********************************************************************
-*** DESCRIPTION : Prints the symbol table to stdout in columnar   ***
+*** DESCRIPTION : Prints the symbol table to os in columnar       ***
 ***               format: LABEL, VALUE, RFLAG, IFLAG, MFLAG.      ***
-***               VALUE is printed as uppercase hex (no 0x) or    ***
-***               explicit string if set. Symbols sorted          ***
+***               VALUE is printed as uppercase hex (no 0x); EQU  ***
+***               values show their low 16 bits. Symbols sorted   ***
 ***               alphabetically.                                 ***
 *** INPUT ARGS  : none                                            ***
 *** OUTPUT ARGS : none                                            ***
-*** IN/OUT ARGS : none                                            ***
+*** IN/OUT ARGS : os - console stream (std::cout by default)      ***
 *** RETURN      : void                                            ***
 ********************************************************************/
-void SymbolTable::display() const {
-    std::cout << "\nSymbol Table\n";
-    std::cout << std::left
-              << std::setw(10) << "LABEL"
-              << std::setw(8)  << "VALUE"
-              << std::setw(7)  << "RFLAG"
-              << std::setw(7)  << "IFLAG"
-              << std::setw(7)  << "MFLAG" << "\n";
+void SymbolTable::display(std::ostream &os) const {
+    os << "\nSymbol Table\n";
+    os << std::left
+       << std::setw(10) << "LABEL"
+       << std::setw(8)  << "VALUE"
+       << std::setw(7)  << "RFLAG"
+       << std::setw(7)  << "IFLAG"
+       << std::setw(7)  << "MFLAG" << "\n";
 
-    std::vector<std::string> names;
-    for (auto &p : pimpl->symbols) names.push_back(p.first);
+    std::vector<std::pair<std::string, int>> names;
+    names.reserve(pimpl->symbols.size());
+    for (size_t i = 0; i < pimpl->symbols.size(); ++i)
+        names.emplace_back(unpackKey(pimpl->symbols[i].key), (int)i);
     std::sort(names.begin(), names.end());
 
-    for (auto &name : names) {
-        const auto &sym = pimpl->symbols.at(name);
-        std::string valueOut;
-        if (!sym.valueStr.empty()) {
-            valueOut = sym.valueStr;         // already a printable hex string (e.g., "200")
-        } else {
-            std::ostringstream oss;
-            oss << std::uppercase << std::hex << sym.value;
-            valueOut = oss.str();            // uppercase hex without 0x
-        }
-        std::cout << std::left
-                  << std::setw(10) << name
-                  << std::setw(8)  << valueOut
-                  << std::setw(7)  << (sym.rflag ? 1 : 0)
-                  << std::setw(7)  << (sym.iflag ? 1 : 0)
-                  << std::setw(7)  << (sym.mflag ? 1 : 0)
-                  << "\n";
+    for (auto &entry : names) {
+        const auto &sym = pimpl->symbols[entry.second];
+        std::ostringstream oss;
+        oss << std::uppercase << std::hex << (sym.equ ? (sym.value & 0xFFFF) : sym.value);
+        os << std::left
+           << std::setw(10) << entry.first
+           << std::setw(8)  << oss.str()   // uppercase hex without 0x
+           << std::setw(7)  << (sym.rflag ? 1 : 0)
+           << std::setw(7)  << (sym.iflag ? 1 : 0)
+           << std::setw(7)  << (sym.mflag ? 1 : 0)
+           << "\n";
     }
-}
\ No newline at end of file
+}
+
+/********************************************************************
+*** FUNCTION getSymbols                                           ***
+*********************************************************************
+*** DESCRIPTION : Exports every symbol (name, value, flags) in    ***
+***               name order, e.g. for the .sym sidecar.          ***
+*** INPUT ARGS  : none                                            ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : vector<Record> - symbols sorted by name         ***
+********************************************************************/
+std::vector<SymbolTable::Record> SymbolTable::getSymbols() const {
+    std::vector<Record> out;
+    out.reserve(pimpl->symbols.size());
+    for (const auto &sym : pimpl->symbols)
+        out.push_back(Record{unpackKey(sym.key), sym.value, sym.rflag, sym.iflag, sym.mflag});
+    std::sort(out.begin(), out.end(),
+              [](const Record &a, const Record &b) { return a.name < b.name; });
+    return out;
+}
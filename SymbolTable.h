@@ -1,34 +1,63 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
+#include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class SymbolTableImpl;
 
 class SymbolTable {
 public:
+    // Stable reference to a symbol record (valid for the table's lifetime)
+    struct Handle {
+        int index = -1;
+        explicit operator bool() const { return index >= 0; }
+    };
+
+    // One symbol as exported to Pass 2 (name is the stored, truncated form)
+    struct Record {
+        std::string name;
+        int  value;
+        bool rflag;
+        bool iflag;
+        bool mflag;
+    };
+
     SymbolTable();
     ~SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
 
-    bool insert(const std::string& name, int value,
+    bool insert(std::string_view name, int value,
                 bool rflag = true, bool iflag = true, bool mflag = false);
-    bool insertWithValueString(const std::string& name, const std::string& valueStr,
-                               bool rflag = true, bool iflag = true, bool mflag = false);
+
+    // Single-search variants: find or insert once, then update through the handle
+    Handle find(std::string_view name) const;
+    Handle insertOrGet(std::string_view name, int value,
+                       bool rflag = true, bool iflag = true, bool mflag = false,
+                       bool* inserted = nullptr);
 
     // Setters for post-insert adjustments
-    bool setMFlag(const std::string& name, bool mflag);
-    bool setValueString(const std::string& name, const std::string& valueStr);
-    bool setValueInt(const std::string& name, int value);
-    bool setFlags(const std::string& name, bool rflag, bool iflag, bool mflag);
+    bool setMFlag(std::string_view name, bool mflag);
+    bool setValueInt(std::string_view name, int value);
+    bool setFlags(std::string_view name, bool rflag, bool iflag, bool mflag);
+
+    void setMFlag(Handle h, bool mflag);
+    void setValueInt(Handle h, int value);
+    void setFlags(Handle h, bool rflag, bool iflag, bool mflag);
+    void setEquValue(Handle h, int value, bool rflag); // EQU result (VALUE shown as 16-bit hex)
 
-    void display() const;
+    void display(std::ostream &os = std::cout) const;
+    std::vector<Record> getSymbols() const;          // sorted by name
 
-    bool exists(const std::string& name) const;
-    int  getAddress(const std::string& name) const;   // numeric value (LOCCTR or EQU result)
-    bool isRelative(const std::string& name) const;
+    bool exists(std::string_view name) const;
+    int  getAddress(std::string_view name) const;   // numeric value (LOCCTR or EQU result)
+    bool isRelative(std::string_view name) const;
 
 private:
     SymbolTableImpl* pimpl;
 };
 
-#endif
\ No newline at end of file
+#endif
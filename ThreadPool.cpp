@@ -0,0 +1,156 @@
+#include "ThreadPool.h"
+#include <utility>
+
+// Pool and deque index of the worker running on this thread, if any
+static thread_local const ThreadPool* t_pool = nullptr;
+static thread_local size_t t_index = 0;
+
+/********************************************************************
+*** FUNCTION ThreadPool (constructor)                             ***
+*********************************************************************
+*** DESCRIPTION : Starts the worker threads (at least one).       ***
+*** INPUT ARGS  : threads - number of workers                     ***
+********************************************************************/
+ThreadPool::ThreadPool(int threads) {
+    if (threads < 1) threads = 1;
+    workers.reserve(threads);
+    for (int i = 0; i < threads; ++i) workers.emplace_back(new Worker);
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+}
+
+/********************************************************************
+*** FUNCTION ~ThreadPool (destructor)                             ***
+*********************************************************************
+*** DESCRIPTION : Lets queued tasks finish, then joins workers.   ***
+********************************************************************/
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> g(idleLock);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (auto &w : workers) w->thread.join();
+}
+
+/********************************************************************
+*** FUNCTION submit                                               ***
+*********************************************************************
+*** DESCRIPTION : Queues one task: on the calling worker's own    ***
+***               deque, or round-robin when called from outside. ***
+*** INPUT ARGS  : task - work to run                              ***
+********************************************************************/
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target = t_index;
+    {
+        // count first so a thief can never take the task before it is counted
+        std::lock_guard<std::mutex> g(idleLock);
+        if (t_pool != this) target = nextWorker++ % workers.size();
+        ++queued;
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> g(workers[target]->lock);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    taskReady.notify_one();
+}
+
+/********************************************************************
+*** FUNCTION wait                                                 ***
+*********************************************************************
+*** DESCRIPTION : Blocks until all submitted tasks have finished, ***
+***               then rethrows the first exception a task threw  ***
+***               since the last wait(), if any.                  ***
+********************************************************************/
+void ThreadPool::wait() {
+    std::exception_ptr thrown;
+    {
+        std::unique_lock<std::mutex> g(idleLock);
+        allDone.wait(g, [this] { return pending == 0; });
+        std::swap(thrown, failure);
+    }
+    if (thrown) std::rethrow_exception(thrown);
+}
+
+/********************************************************************
+*** FUNCTION parallelFor                                          ***
+*********************************************************************
+*** DESCRIPTION : Submits fn(i) for each i in [0, count) and      ***
+***               waits for all of them.                          ***
+*** INPUT ARGS  : count - number of work items                    ***
+***               fn    - work item body (must be thread-safe)    ***
+********************************************************************/
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    for (size_t i = 0; i < count; ++i)
+        submit([&fn, i] { fn(i); });
+    wait();
+}
+
+/********************************************************************
+*** FUNCTION take                                                 ***
+*********************************************************************
+*** DESCRIPTION : Pops the newest task from the worker's own      ***
+***               deque, or steals the oldest from another one.   ***
+*** INPUT ARGS  : self - worker index                             ***
+*** OUTPUT ARGS : task - the task to run                          ***
+*** RETURN      : bool - false if every deque was empty           ***
+********************************************************************/
+bool ThreadPool::take(size_t self, std::function<void()>& task) {
+    bool found = false;
+    {
+        Worker &own = *workers[self];
+        std::lock_guard<std::mutex> g(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    for (size_t k = 1; !found && k < workers.size(); ++k) {
+        Worker &victim = *workers[(self + k) % workers.size()];
+        std::lock_guard<std::mutex> g(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (found) {
+        std::lock_guard<std::mutex> g(idleLock);
+        --queued;
+    }
+    return found;
+}
+
+/********************************************************************
+*** FUNCTION workerLoop                                           ***
+*********************************************************************
+*** DESCRIPTION : Worker body: run or steal tasks, sleep when     ***
+***               nothing is queued, exit once the pool stops and ***
+***               all queues are drained. An exception from a     ***
+***               task is caught and kept for wait().             ***
+*** INPUT ARGS  : self - worker index                             ***
+********************************************************************/
+void ThreadPool::workerLoop(size_t self) {
+    t_pool = this;
+    t_index = self;
+    for (;;) {
+        std::function<void()> task;
+        if (take(self, task)) {
+            std::exception_ptr thrown;
+            try {
+                task();
+            } catch (...) {
+                thrown = std::current_exception();
+            }
+            std::lock_guard<std::mutex> g(idleLock);
+            if (thrown && !failure) failure = thrown;
+            if (--pending == 0) allDone.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> g(idleLock);
+        taskReady.wait(g, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/********************************************************************
+*** CLASS ThreadPool                                              ***
+*********************************************************************
+*** DESCRIPTION : Fixed set of work-stealing worker threads. Each ***
+***               worker owns a task deque: it runs its own tasks ***
+***               newest-first and, when empty, steals the oldest ***
+***               task from another worker. Outside submissions   ***
+***               are dealt round-robin; tasks submitted from a   ***
+***               worker go to that worker's deque. wait() blocks ***
+***               until every task has finished (do not call it   ***
+***               from a task). A task that throws does not take  ***
+***               its worker down: the first exception is kept    ***
+***               and rethrown by the next wait(). Workers are    ***
+***               joined on destruction.                          ***
+********************************************************************/
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();
+    int  size() const { return (int)workers.size(); }
+
+    // Run fn(0..count-1) across the pool and wait for all of them; rethrows
+    // the first exception any fn threw
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    struct Worker {
+        std::deque<std::function<void()>> tasks;
+        std::mutex lock;
+        std::thread thread;
+    };
+
+    bool take(size_t self, std::function<void()>& task);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex idleLock;                 // guards the counters below
+    std::condition_variable taskReady;
+    std::condition_variable allDone;
+    size_t queued = 0;                   // tasks sitting in some deque
+    size_t pending = 0;                  // queued + running
+    size_t nextWorker = 0;               // round-robin target for outside submits
+    std::exception_ptr failure;          // first exception a task threw, for wait()
+    bool stopping = false;
+};
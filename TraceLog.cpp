@@ -0,0 +1,103 @@
+#include "TraceLog.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <unistd.h>
+
+// Small, stable per-thread ids (1, 2, ...) in order of first use
+static int traceThreadId() {
+    static std::atomic<int> next{1};
+    thread_local int id = next.fetch_add(1);
+    return id;
+}
+
+static double micros(TraceLog::Clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(t.time_since_epoch()).count();
+}
+
+// JSON string body (names and paths only need quote/backslash escaping)
+static void jsonString(std::ostream &os, const std::string &s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+TraceLog::TraceLog(const std::string &processName)
+    : processName(processName), mainTid(traceThreadId()) {}
+
+/********************************************************************
+*** FUNCTION TraceLog::span                                       ***
+*********************************************************************
+*** DESCRIPTION : Records one span on the calling thread's track. ***
+*** INPUT ARGS  : name, category - span label and "cat" field     ***
+***               begin, end     - wall times                     ***
+***               args           - shown in the span's details    ***
+********************************************************************/
+void TraceLog::span(const std::string &name, const char *category, Clock::time_point begin,
+                    Clock::time_point end, const TraceArgs &args) {
+    Event e{name, category, micros(begin), micros(end) - micros(begin), traceThreadId(), args};
+    std::lock_guard<std::mutex> g(lock);
+    events.push_back(std::move(e));
+}
+
+/********************************************************************
+*** FUNCTION TraceLog::write                                      ***
+*********************************************************************
+*** DESCRIPTION : Writes {"traceEvents": [...]}: process and      ***
+***               thread name metadata, then the spans by start   ***
+***               time, one event per line.                       ***
+*** INPUT ARGS  : path - output file                              ***
+*** OUTPUT ARGS : err  - reason on failure                        ***
+*** RETURN      : bool - false if the file could not be written   ***
+********************************************************************/
+bool TraceLog::write(const std::string &path, std::string &err) const {
+    std::lock_guard<std::mutex> g(lock);
+    std::vector<const Event*> sorted;
+    std::vector<int> tids;
+    for (const Event &e : events) {
+        sorted.push_back(&e);
+        if (std::find(tids.begin(), tids.end(), e.tid) == tids.end()) tids.push_back(e.tid);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Event *a, const Event *b) { return a->beginUs < b->beginUs; });
+    std::sort(tids.begin(), tids.end());
+
+    std::ofstream out(path);
+    if (!out) { err = "cannot write " + path; return false; }
+    long pid = (long)getpid();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << pid
+        << ", \"tid\": " << mainTid << ", \"args\": {\"name\": ";
+    jsonString(out, processName);
+    out << "}}";
+    for (int tid : tids) {
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+            << ", \"tid\": " << tid << ", \"args\": {\"name\": \""
+            << (tid == mainTid ? "main" : "worker " + std::to_string(tid)) << "\"}}";
+    }
+    for (const Event *e : sorted) {
+        out << ",\n{\"name\": ";
+        jsonString(out, e->name);
+        out << ", \"cat\": \"" << e->category << "\", \"ph\": \"X\", \"ts\": " << e->beginUs
+            << ", \"dur\": " << e->durationUs << ", \"pid\": " << pid << ", \"tid\": " << e->tid
+            << ", \"args\": {";
+        for (size_t i = 0; i < e->args.size(); ++i) {
+            if (i) out << ", ";
+            jsonString(out, e->args[i].first);
+            out << ": ";
+            double v = e->args[i].second;
+            if (v == (double)(long long)v) out << (long long)v;
+            else out << v;
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+    out.close();
+    if (!out) { err = "cannot write " + path; return false; }
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Named numeric arguments of a trace span (line counts, bytes, ...)
+typedef std::vector<std::pair<std::string, double>> TraceArgs;
+
+/********************************************************************
+*** CLASS TraceLog                                                ***
+*********************************************************************
+*** DESCRIPTION : What --trace writes: complete ("X") spans in    ***
+***               Chrome trace-event JSON, loadable in            ***
+***               chrome://tracing and Perfetto. Spans may be     ***
+***               added from any thread and are tagged with a     ***
+***               small per-thread id. Timestamps are steady_clock***
+***               microseconds, so traces of the Pass1 and Pass2  ***
+***               processes of one build line up when merged.     ***
+********************************************************************/
+class TraceLog {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // processName labels this process's track (e.g. "Pass1 test.asm")
+    explicit TraceLog(const std::string &processName);
+
+    void span(const std::string &name, const char *category, Clock::time_point begin,
+              Clock::time_point end, const TraceArgs &args = TraceArgs());
+    bool write(const std::string &path, std::string &err) const;
+
+private:
+    struct Event {
+        std::string name;
+        const char *category;
+        double beginUs, durationUs;
+        int tid;
+        TraceArgs args;
+    };
+    std::string processName;
+    int mainTid;                    // the constructing thread is named "main"
+    mutable std::mutex lock;
+    std::vector<Event> events;
+};
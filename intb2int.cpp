@@ -0,0 +1,48 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "Pass1Core.h"
+#include "Intermediate.h"
+
+using namespace std;
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Debug converter from the binary intermediate    ***
+***               (.intb) back to the text .int layout Pass1      ***
+***               writes. Output defaults to <base>.int; "-"      ***
+***               writes to stdout.                               ***
+*** INPUT ARGS  : argc, argv - intb2int <file.intb> [out.int|-]   ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 on success; non-zero on errors          ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        cerr << "Usage: intb2int <file.intb> [out.int|-]\n";
+        return 1;
+    }
+    string inName = argv[1];
+    string outName = (argc == 3) ? argv[2]
+                                 : inName.substr(0, inName.find_last_of('.')) + ".int";
+
+    Pass1Result result;
+    string err;
+    if (!readIntermediateBinaryRows(inName, result, err)) {
+        cerr << "Error: " << err << endl;
+        return 1;
+    }
+
+    if (outName == "-") {
+        writeIntermediate(cout, result);
+        return 0;
+    }
+    ofstream out(outName);
+    if (!out.is_open()) {
+        cerr << "Error: Cannot open " << outName << endl;
+        return 1;
+    }
+    writeIntermediate(out, result);
+    return 0;
+}
@@ -0,0 +1,301 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AllocStats.h"
+#include "SymbolTable.h"
+#include "LiteralTable.h"
+#include "OpcodeTable.h"
+#include "Pass1Core.h"
+#include "Pass2Core.h"
+#include "SymbolFile.h"
+#include "SourceGenerator.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+#ifdef SICXE_ALLOC_STATS
+// The accounting build's hooks (AllocStats.cpp) already count every new
+static long allocsSoFar() { return allocCount(); }
+#else
+// Every operator new in this binary is counted (array forms forward here)
+static atomic<long> g_allocs{0};
+
+void *operator new(size_t n) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static long allocsSoFar() { return g_allocs.load(memory_order_relaxed); }
+#endif
+
+// Results feed this so the optimizer cannot drop the measured calls
+static volatile long g_sink;
+
+/********************************************************************
+*** STRUCT MicroResult                                            ***
+*********************************************************************
+*** DESCRIPTION : One primitive's cost: time and heap allocations ***
+***               per operation, averaged over every timed batch. ***
+********************************************************************/
+struct MicroResult {
+    string name;
+    long   ops = 0;          // operations timed in total
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+};
+
+/********************************************************************
+*** FUNCTION measure                                              ***
+*********************************************************************
+*** DESCRIPTION : Runs setup() then body() (opsPerBatch ops) until***
+***               the bodies have taken minSeconds; only body()   ***
+***               is timed and has its allocations counted. One   ***
+***               untimed warm-up batch runs first.               ***
+*** INPUT ARGS  : name, opsPerBatch, minSeconds, setup, body      ***
+*** RETURN      : MicroResult                                     ***
+********************************************************************/
+static MicroResult measure(const string &name, long opsPerBatch, double minSeconds,
+                           const function<void()> &setup, const function<void()> &body) {
+    setup();
+    body();
+    MicroResult r;
+    r.name = name;
+    double seconds = 0;
+    long allocs = 0;
+    do {
+        setup();
+        long a0 = allocsSoFar();
+        Clock::time_point t0 = Clock::now();
+        body();
+        seconds += chrono::duration<double>(Clock::now() - t0).count();
+        allocs += allocsSoFar() - a0;
+        r.ops += opsPerBatch;
+    } while (seconds < minSeconds);
+    r.nsPerOp = seconds * 1e9 / (double)r.ops;
+    r.allocsPerOp = (double)allocs / (double)r.ops;
+    return r;
+}
+
+// Symbol named by a source operand (#, @ and ,X stripped), or "" if none
+static string operandSymbol(const string &operand) {
+    string s = operand;
+    if (!s.empty() && (s[0] == '#' || s[0] == '@')) s.erase(0, 1);
+    size_t comma = s.find(',');
+    if (comma != string::npos) s.erase(comma);
+    if (s.empty() || !isalpha((unsigned char)s[0])) return "";
+    return s;
+}
+
+static vector<string> splitLines(const string &text) {
+    vector<string> out;
+    istringstream in(text);
+    string s;
+    while (getline(in, s)) out.push_back(s);
+    return out;
+}
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Microbenchmarks for the hot primitives. Keys    ***
+***               come from a generated program (sicxegen's       ***
+***               default mix), so lookups see the mnemonic,      ***
+***               symbol and literal distributions of real source,***
+***               and genObj runs on that program's own lines,    ***
+***               grouped by instruction format.                  ***
+*** INPUT ARGS  : argc, argv - [--lines N] [--min-time S]         ***
+***                            [--filter TEXT] [--json]           ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 on success; non-zero on errors          ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    const char *usage = "Usage: microbench [--lines N] [--min-time SECONDS] [--filter TEXT] [--json]\n";
+    GeneratorOptions gen;
+    gen.lines = 20000;
+    double minSeconds = 0.2;
+    string filter;
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--json") json = true;
+        else if (arg == "--lines" && i + 1 < argc) gen.lines = atol(argv[++i]);
+        else if (arg == "--min-time" && i + 1 < argc) minSeconds = atof(argv[++i]);
+        else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else { cerr << usage; return 1; }
+    }
+    if (gen.lines < 100 || minSeconds <= 0) { cerr << usage; return 1; }
+
+    // Corpus: one generated program, assembled once to get .int rows and tables
+    ostringstream src;
+    string err;
+    if (!SourceGenerator(gen).writeStream(src, err)) { cerr << "Error: " << err << endl; return 1; }
+    const string sourceText = src.str();
+    const vector<string> sourceLines = splitLines(sourceText);
+
+    OpcodeTable optab;
+    SymbolTable symtab;
+    LiteralTable littab;
+    Pass1Result pass1;
+    SourceLexer lexer;
+    lexer.attach(sourceText);
+    runPass1(lexer, symtab, littab, optab, pass1);
+    ostringstream intText;
+    writeIntermediate(intText, pass1);
+    const vector<string> intLines = splitLines(intText.str());
+
+    Pass2Program prog;
+    loadProgramTables(symtab, littab, prog);
+
+    vector<string> mnemonics, labels, symbolRefs, literals;
+    for (const string &raw : sourceLines) {
+        ParsedLine p = parseLine(raw);
+        if (p.isComment || p.opcode.empty()) continue;
+        mnemonics.push_back(p.opcode);
+        if (!p.label.empty()) labels.push_back(p.label.substr(0, p.label.find(':')));
+        if (!p.operand.empty() && p.operand[0] == '=') literals.push_back(p.operand);
+        else {
+            string sym = operandSymbol(p.operand);
+            if (!sym.empty()) symbolRefs.push_back(sym);
+        }
+    }
+
+    // Pass 2 lines with the BASE value in effect, grouped by what genObj encodes
+    vector<Line> groups[5];
+    vector<int> groupBase[5];
+    static const char *const GROUP_NAMES[5] = {"format1", "format2", "format3", "format4", "data"};
+    int baseReg = -1;
+    for (const string &raw : intLines) {
+        Line L;
+        if (!parseListing(raw, L)) continue;
+        if (L.op == "BASE") {
+            auto it = prog.symaddr.find(symbolKey(L.operand));
+            if (it != prog.symaddr.end()) baseReg = it->second;
+            continue;
+        }
+        if (L.op == "NOBASE") { baseReg = -1; continue; }
+        int g = -1;
+        OpcodeTable::Entry e;
+        if (!L.op.empty() && L.op[0] == '+') g = 3;
+        else if (optab.lookup(L.op, e)) g = e.format - 1;
+        else if (L.isLiteral || L.op == "WORD" || L.op == "BYTE") g = 4;
+        if (g < 0) continue;
+        groups[g].push_back(L);
+        groupBase[g].push_back(baseReg);
+    }
+
+    vector<MicroResult> results;
+    auto run = [&](const string &name, long ops, const function<void()> &setup,
+                   const function<void()> &body) {
+        if (!filter.empty() && name.find(filter) == string::npos) return;
+        if (ops > 0) results.push_back(measure(name, ops, minSeconds, setup, body));
+    };
+    auto none = [] {};
+
+    run("OpcodeTable::exists", (long)mnemonics.size(), none, [&] {
+        long n = 0;
+        for (const string &m : mnemonics) n += optab.exists(m);
+        g_sink = n;
+    });
+    run("OpcodeTable::getFormat", (long)mnemonics.size(), none, [&] {
+        long n = 0;
+        for (const string &m : mnemonics) n += optab.getFormat(m);
+        g_sink = n;
+    });
+    run("OpcodeTable::getOpcode", (long)mnemonics.size(), none, [&] {
+        long n = 0;
+        for (const string &m : mnemonics) n += optab.getOpcode(m);
+        g_sink = n;
+    });
+
+    unique_ptr<SymbolTable> fresh;
+    run("SymbolTable::insert", (long)labels.size(), [&] { fresh.reset(new SymbolTable); }, [&] {
+        for (size_t i = 0; i < labels.size(); ++i) fresh->insert(labels[i], (int)i);
+    });
+    run("SymbolTable::getAddress", (long)symbolRefs.size(), none, [&] {
+        long n = 0;
+        for (const string &s : symbolRefs) n += symtab.getAddress(s);
+        g_sink = n;
+    });
+    run("SymbolTable::setMFlag", (long)labels.size(), none, [&] {
+        for (const string &s : labels) symtab.setMFlag(s, true);
+    });
+
+    unique_ptr<LiteralTable> lits;
+    run("LiteralTable::insert", (long)literals.size(), [&] { lits.reset(new LiteralTable); }, [&] {
+        for (const string &l : literals) lits->insert(l);
+    });
+    long distinct = (long)littab.getLiterals().size();
+    run("LiteralTable::assignAddresses", distinct, [&] {
+        lits.reset(new LiteralTable);
+        for (const string &l : literals) lits->insert(l);
+    }, [&] { g_sink = lits->assignAddresses(0); });
+    run("LiteralTable::getAssignedLiterals", 100, none, [&] {
+        long n = 0;
+        for (int i = 0; i < 100; ++i) n += (long)littab.getAssignedLiterals().size();
+        g_sink = n;
+    });
+
+    run("parseLine", (long)sourceLines.size(), none, [&] {
+        long n = 0;
+        for (const string &raw : sourceLines) n += (long)parseLine(raw).opcode.size();
+        g_sink = n;
+    });
+    run("parseListing", (long)intLines.size(), none, [&] {
+        long n = 0;
+        for (const string &raw : intLines) {
+            Line L;
+            n += parseListing(raw, L);
+        }
+        g_sink = n;
+    });
+
+    vector<uint8_t> image;
+    vector<Diagnostic> errs;
+    for (int g = 0; g < 5; ++g) {
+        vector<Line> &lines = groups[g];
+        const vector<int> &bases = groupBase[g];
+        run(string("genObj/") + GROUP_NAMES[g], (long)lines.size(),
+            [&] { image.clear(); errs.clear(); }, [&] {
+            for (size_t i = 0; i < lines.size(); ++i)
+                genObj(lines[i], prog.symaddr, prog.litaddr, optab, bases[i], image, errs);
+        });
+    }
+    if (!errs.empty()) cerr << "warning: genObj reported " << errs.size() << " errors\n";
+
+    if (json) {
+        cout << "{\"lines\": " << gen.lines << ", \"results\": [\n" << fixed;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const MicroResult &r = results[i];
+            cout << "  {\"name\": \"" << r.name << "\", \"ops\": " << r.ops
+                 << ", \"ns_per_op\": " << setprecision(2) << r.nsPerOp
+                 << ", \"allocs_per_op\": " << setprecision(3) << r.allocsPerOp << "}"
+                 << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        cout << "]}\n";
+        return 0;
+    }
+    cout << "Corpus: " << gen.lines << " generated lines (" << mnemonics.size() << " mnemonics, "
+         << labels.size() << " labels, " << symbolRefs.size() << " symbol refs, "
+         << literals.size() << " literal refs, " << distinct << " distinct)\n\n";
+    cout << left << setw(36) << "BENCHMARK" << right << setw(12) << "OPS"
+         << setw(12) << "NS/OP" << setw(12) << "ALLOCS/OP" << "\n";
+    for (const MicroResult &r : results) {
+        cout << left << setw(36) << r.name << right << setw(12) << r.ops << fixed
+             << setprecision(1) << setw(12) << r.nsPerOp
+             << setprecision(2) << setw(12) << r.allocsPerOp << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,339 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <thread>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unistd.h>
+#include "SymbolTable.h"
+#include "LiteralTable.h"
+#include "OpcodeTable.h"
+#include "Pass1Core.h"
+#include "Pass2Core.h"
+#include "Intermediate.h"
+#include "SymbolFile.h"
+#include "Batch.h"
+#include "OutputSink.h"
+#include "RunStats.h"
+#include "ObjectCache.h"
+#include "FileWatcher.h"
+
+using namespace std;
+
+// How long the source must stay unchanged before --watch rebuilds it
+static const int WATCH_QUIET_MS = 50;
+
+typedef chrono::steady_clock Clock;
+
+// Single-file options (everything but --batch, --manifest and --trace)
+struct SingleOptions {
+    string filename, sinkKind;
+    bool writeInt = false, quiet = false, incremental = false;
+    int jobs = 1;
+};
+
+static string cacheFileFor(const string &source) {
+    return source.substr(0, source.find_last_of('.')) + ".objcache";
+}
+
+/********************************************************************
+*** FUNCTION assembleSingle                                       ***
+*********************************************************************
+*** DESCRIPTION : One fused build of one source: Pass 1, optional ***
+***               .int/.sym, Pass 2 and the listing/object files, ***
+***               with the usual console output.                  ***
+*** INPUT ARGS  : opt   - source and output options               ***
+***               optab - opcode table (kept warm by --watch)     ***
+*** IN/OUT ARGS : cache - object code cache (null for none); saved***
+***                       to disk with --incremental              ***
+***               stats - phase spans for --trace (may be null)   ***
+*** RETURN      : bool - false (after printing why) on failure    ***
+********************************************************************/
+static bool assembleSingle(const SingleOptions &opt, const OpcodeTable &optab,
+                           ObjectCache *cache, RunStats *stats) {
+    const string &filename = opt.filename;
+    const string &sinkKind = opt.sinkKind;
+    bool quiet = opt.quiet, incremental = opt.incremental;
+    int jobs = opt.jobs;
+    string err;
+
+    SourceLexer sourceFile;
+    string openErr;
+    bool opened;
+    {
+        PhaseTimer t(stats, "read");
+        opened = sourceFile.open(filename, openErr);
+    }
+    if (!opened) {
+        cerr << "Error: Cannot open file " << filename << endl;
+        return false;
+    }
+
+    // Console: stdout, or nothing at all with --quiet
+    NullSink nullSink;
+    SinkStream quietConsole(nullSink);
+    ostream &con = quiet ? static_cast<ostream&>(quietConsole) : cout;
+    bool echo = !quiet && sinkKind != "stdout";
+
+    Pass1Sections p1;
+
+    con << "\n========== PASS 1 - SIC/XE ASSEMBLER ==========" << endl;
+    con << "Processing file: " << filename << endl;
+
+    runPass1Sections(sourceFile, optab, p1, jobs, cerr, stats);
+
+    string baseName = filename.substr(0, filename.find_last_of('.'));
+    if (opt.writeInt) {
+        PhaseTimer t(stats, ".int + .sym write");
+        unique_ptr<OutputSink> intSink = makeSink(sinkKind, baseName + ".int", err, incremental);
+        if (!intSink) {
+            cerr << "Error: " << err << endl;
+            return false;
+        }
+        {
+            SinkStream os(*intSink);
+            writeIntermediate(os, p1);
+        }
+        if (!intSink->finish(err) ||
+            !writeSymbolFile(symbolFileFor(filename), p1, err)) {
+            cerr << "Error: " << err << endl;
+            return false;
+        }
+        con << "\nIntermediate file written to: " << intSink->name() << endl;
+    }
+
+    printPass1Summary(p1, con);
+
+    con << "========== PASS 2 - SIC/XE ASSEMBLER ==========\n";
+    con << "Processing file: " << filename << "\n\n";
+
+    vector<Pass2Section> sections;
+    loadProgramSections(p1, sections);
+    size_t lineCount = 0, imageBytes = 0, errorCount = 0;
+    {
+        PhaseTimer t(stats, "code generation");
+        assembleSections(sections, optab, jobs, stats, cache);
+        for (const auto &sec : sections) {
+            lineCount += sec.lines.size();
+            imageBytes += sec.prog.image.size();
+            errorCount += sec.prog.errors.size();
+        }
+        t.arg("lines", (double)lineCount);
+        t.arg("object bytes", (double)imageBytes);
+    }
+
+    unique_ptr<OutputSink> lst = makeSink(sinkKind, baseName + ".txt", err, incremental);
+    unique_ptr<OutputSink> obj = lst ? makeSink(sinkKind, baseName + ".obj", err, incremental) : nullptr;
+    if (!lst || !obj) { cerr << err << "\n"; return false; }
+    if (!writePass2Files(sections, *lst, *obj, con, echo, stats)) return false;
+    if (cache) {
+        if (incremental && !cache->save(cacheFileFor(filename), err))
+            cerr << "Warning: " << err << "\n";
+        con << "Incremental: " << cache->hits << " lines reused, " << cache->misses
+            << " regenerated\n";
+    }
+
+    if (quiet) printPass2Errors(sections, cerr);
+    else printPass2Report(sections, con);
+
+    if (stats) {
+        stats->setCount("lines", (long)lineCount);
+        stats->setCount("object bytes", (long)imageBytes);
+        stats->setCount("errors", (long)errorCount);
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION assembleFilter                                       ***
+*********************************************************************
+*** DESCRIPTION : Filter mode (sicxe -). Pass 1 lexes stdin line  ***
+***               by line as it arrives, so it runs alongside the ***
+***               program generating the source; the object       ***
+***               program then goes to stdout and the listing to  ***
+***               listingFd. Diagnostics go to stderr. Nothing is ***
+***               written to disk.                                ***
+*** INPUT ARGS  : optab     - opcode table                        ***
+***               jobs      - code generation threads             ***
+***               listingFd - open descriptor, or -1 for none     ***
+*** RETURN      : bool - false if stdin or an output failed       ***
+********************************************************************/
+static bool assembleFilter(const OpcodeTable &optab, int jobs, int listingFd) {
+    SourceLexer source;
+    source.readFrom(STDIN_FILENO);
+    Pass1Sections p1;
+    runPass1Sections(source, optab, p1, 1, cerr);
+    if (!source.readError().empty()) {
+        cerr << "Error: standard input: " << source.readError() << endl;
+        return false;
+    }
+
+    vector<Pass2Section> sections;
+    loadProgramSections(p1, sections);
+    assembleSections(sections, optab, jobs);
+
+    StdoutSink obj;
+    FileSink listingFile;
+    NullSink noListing, nullSink;
+    if (listingFd >= 0) listingFile.adopt(listingFd, "fd " + to_string(listingFd));
+    OutputSink &lst = listingFd >= 0 ? static_cast<OutputSink&>(listingFile) : noListing;
+    SinkStream quietConsole(nullSink);
+    if (!writePass2Files(sections, lst, obj, quietConsole, false)) return false;
+    printPass2Errors(sections, cerr);
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Fused SIC/XE assembler. Runs Pass 1 and hands    ***
+***               its rows and tables to the Pass 2 code generator ***
+***               in memory. The .int (and its .sym) are only      ***
+***               written when --int is given; listing and object  ***
+***               output match the Pass1 + Pass2 pair byte for     ***
+***               byte. --batch assembles many sources at once on ***
+***               a thread pool (see Batch.cpp). --incremental      ***
+***               reuses cached object code and leaves unchanged  ***
+***               outputs untouched (single file only). --watch    ***
+***               rebuilds whenever the source changes, keeping   ***
+***               the opcode table and object code cache in memory.***
+***               A source of "-" is filter mode: stdin to object ***
+***               program on stdout (listing on --listing-fd N).  ***
+*** INPUT ARGS  : argc, argv - sicxe <source.asm> [--int]          ***
+***                             [--jobs N] [--incremental] [--watch]***
+***                          sicxe - [--listing-fd N] [--jobs N]   ***
+***                          sicxe --batch [--jobs N]              ***
+***                             [--manifest FILE] <source.asm>...  ***
+***                          both: [--sink file|stdout|memory|null]***
+***                             [--quiet] [--trace FILE]           ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 on success; non-zero on errors          ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    string filename;
+    bool writeInt = false, batch = false, quiet = false, incremental = false, watch = false;
+    string sinkKind = "file", tracePath;
+    int jobs = 0, listingFd = -1;
+    vector<string> sources;
+    const char *usage = "Usage: sicxe <source.asm> [--int] [--jobs N] [--incremental] [--watch]\n"
+                        "       sicxe --batch [--jobs N] [--manifest FILE] <source.asm>...\n"
+                        "       sicxe - [--listing-fd N] [--jobs N]   (stdin -> object program on stdout)\n"
+                        "       options: [--sink file|stdout|memory|null] [--quiet] [--trace FILE]"
+                        " (batch: no stdout sink)\n";
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--int") writeInt = true;
+        else if (arg == "--batch") batch = true;
+        else if (arg == "--quiet") quiet = true;
+        else if (arg == "--incremental") incremental = true;
+        else if (arg == "--watch") watch = true;
+        else if (arg == "--trace" && i + 1 < argc) tracePath = argv[++i];
+        else if (arg == "--sink" && i + 1 < argc) {
+            sinkKind = argv[++i];
+            if (!isSinkKind(sinkKind)) { cerr << usage; return 1; }
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs < 1) { cerr << usage; return 1; }
+        }
+        else if (arg == "--listing-fd" && i + 1 < argc) {
+            listingFd = atoi(argv[++i]);
+            if (listingFd < 0 || listingFd == STDOUT_FILENO) { cerr << usage; return 1; }
+        }
+        else if (arg == "--manifest" && i + 1 < argc) {
+            string err;
+            if (!readManifest(argv[++i], sources, err)) {
+                cerr << "Error: " << err << endl;
+                return 1;
+            }
+        }
+        else sources.push_back(arg);
+    }
+    unique_ptr<TraceLog> trace;
+    if (!tracePath.empty()) trace.reset(new TraceLog(batch ? "sicxe --batch" : "sicxe"));
+    string err;
+    if (batch) {
+        if (sources.empty() || writeInt || incremental || watch || listingFd >= 0 ||
+            sinkKind == "stdout") {
+            cerr << usage;
+            return 1;
+        }
+        if (jobs == 0) jobs = max(1u, thread::hardware_concurrency());
+        NullSink nullSink;
+        SinkStream quietConsole(nullSink);
+        bool ok = runBatch(sources, jobs, sinkKind,
+                           quiet ? static_cast<ostream&>(quietConsole) : cout, cerr, trace.get());
+        if (trace && !trace->write(tracePath, err)) {
+            cerr << "Error: " << err << endl;
+            return 1;
+        }
+        return ok ? 0 : 1;
+    }
+    if (sources.size() != 1 || (watch && trace)) {
+        cerr << usage;
+        return 1;
+    }
+    if (sources[0] == "-" || listingFd >= 0) {
+        if (sources[0] != "-" || writeInt || incremental || watch || trace || sinkKind != "file") {
+            cerr << usage;
+            return 1;
+        }
+        OpcodeTable optab;
+        return assembleFilter(optab, jobs == 0 ? 1 : jobs, listingFd) ? 0 : 1;
+    }
+    SingleOptions opt;
+    opt.filename = sources[0];
+    opt.sinkKind = sinkKind;
+    opt.writeInt = writeInt;
+    opt.quiet = quiet;
+    opt.incremental = incremental;
+    opt.jobs = jobs == 0 ? 1 : jobs;
+    OpcodeTable optab;
+    ObjectCache cache;
+    if (incremental && !cache.load(cacheFileFor(opt.filename), err))
+        cerr << "Warning: " << err << "\n";
+
+    if (!watch) {
+        // Only --trace uses the stats here (phases become its spans)
+        unique_ptr<RunStats> stats;
+        if (trace) {
+            stats.reset(new RunStats("sicxe", opt.filename));
+            stats->attachTrace(trace.get());
+        }
+        bool ok = assembleSingle(opt, optab, incremental ? &cache : nullptr, stats.get());
+        if (trace) {
+            stats->traceRun();
+            if (!trace->write(tracePath, err)) {
+                cerr << "Error: " << err << endl;
+                return 1;
+            }
+        }
+        return ok ? 0 : 1;
+    }
+
+    // --watch: rebuild on every settled change, keeping the opcode table and
+    // the object code cache resident between rebuilds
+    FileWatcher watcher;
+    if (!watcher.open(opt.filename, err)) {
+        cerr << "Error: " << err << endl;
+        return 1;
+    }
+    ostream &status = quiet ? cerr : cout;
+    for (int build = 1; ; ++build) {
+        Clock::time_point t0 = Clock::now();
+        bool ok = assembleSingle(opt, optab, &cache, nullptr);
+        cache.nextRun();
+        status << "[watch] build " << build << " of " << opt.filename << ": "
+               << (ok ? "ok" : "FAILED") << " in " << fixed << setprecision(1)
+               << chrono::duration<double, milli>(Clock::now() - t0).count() << " ms; waiting for changes"
+               << defaultfloat << setprecision(6) << endl;
+        if (!watcher.wait(WATCH_QUIET_MS, err)) {
+            cerr << "Error: " << err << endl;
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,384 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SourceGenerator.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/********************************************************************
+*** STRUCT BenchResult                                            ***
+*********************************************************************
+*** DESCRIPTION : One measured phase over one corpus: pass1,      ***
+***               pass2, or total (both, back to back). Seconds   ***
+***               are the best of the repeats; RSS the worst.     ***
+********************************************************************/
+struct BenchResult {
+    string name;            // phase/lines, the key baselines are matched on
+    string phase;
+    long   lines = 0;
+    int    files = 0;
+    long   bytes = 0;       // input bytes: .asm for pass1/total, .int for pass2
+    double seconds = 0;
+    long   peakRssKb = 0;
+    long   diagnostics = 0; // stderr lines (a generator bug if not 0)
+
+    double linesPerSec() const { return seconds > 0 ? lines / seconds : 0; }
+    double mbPerSec() const { return seconds > 0 ? bytes / 1e6 / seconds : 0; }
+};
+
+static long fileSize(const string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long)st.st_size : 0;
+}
+
+static long countLines(const string &path) {
+    ifstream in(path);
+    long n = 0;
+    string s;
+    while (getline(in, s)) ++n;
+    return n;
+}
+
+/********************************************************************
+*** FUNCTION runTimed                                             ***
+*********************************************************************
+*** DESCRIPTION : Runs one assembler process with stdout          ***
+***               discarded and stderr to errFile; measures wall  ***
+***               time and the child's peak RSS (wait4).          ***
+*** INPUT ARGS  : args - argv (args[0] is the program path)       ***
+***               errFile - stderr destination                    ***
+*** OUTPUT ARGS : seconds, rssKb; err - reason on failure         ***
+*** RETURN      : bool - false if the process could not run or    ***
+***               exited non-zero                                 ***
+********************************************************************/
+static bool runTimed(const vector<string> &args, const string &errFile,
+                     double &seconds, long &rssKb, string &err) {
+    vector<char*> argv;
+    for (const string &a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    Clock::time_point t0 = Clock::now();
+    pid_t pid = fork();
+    if (pid < 0) { err = string("fork failed: ") + strerror(errno); return false; }
+    if (pid == 0) {
+        int out = open("/dev/null", O_WRONLY);
+        int errFd = open(errFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out >= 0) dup2(out, STDOUT_FILENO);
+        if (errFd >= 0) dup2(errFd, STDERR_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) { err = string("wait4 failed: ") + strerror(errno); return false; }
+    seconds = chrono::duration<double>(Clock::now() - t0).count();
+    rssKb = ru.ru_maxrss;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        err = args[0] + " " + args.back() + " failed (exit status " +
+              to_string(WIFEXITED(status) ? WEXITSTATUS(status) : -1) + ")";
+        return false;
+    }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION benchCorpus                                          ***
+*********************************************************************
+*** DESCRIPTION : Generates a corpus of `lines` lines under dir,  ***
+***               then runs Pass1 and Pass2 (--quiet) over every  ***
+***               program, repeat times, and fills the pass1,     ***
+***               pass2 and total results. The corpus and its     ***
+***               outputs are removed afterwards unless keep.     ***
+*** INPUT ARGS  : opts - generator shape (opts.lines is set here) ***
+***               bin - directory holding Pass1/Pass2; dir, repeat***
+***               keep - leave the corpus on disk                 ***
+*** OUTPUT ARGS : results - three entries appended; err           ***
+*** RETURN      : bool - false on any failure                     ***
+********************************************************************/
+static bool benchCorpus(GeneratorOptions opts, long lines, const string &bin, const string &dir,
+                        int repeat, bool keep, vector<BenchResult> &results, string &err) {
+    opts.lines = lines;
+    string corpusDir = dir + "/corpus-" + to_string(lines);
+    if (mkdir(corpusDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        err = "cannot create " + corpusDir + ": " + strerror(errno);
+        return false;
+    }
+    vector<GeneratedFile> files;
+    SourceGenerator gen(opts);
+    if (!gen.writeFiles(corpusDir + "/gen", files, err)) return false;
+
+    BenchResult p1, p2, total;
+    p1.phase = "pass1"; p2.phase = "pass2"; total.phase = "total";
+    for (BenchResult *r : {&p1, &p2, &total}) {
+        r->name = r->phase + "/" + to_string(lines);
+        r->lines = lines;
+        r->files = (int)files.size();
+    }
+
+    bool ok = true;
+    for (int rep = 0; rep < repeat && ok; ++rep) {
+        double s1 = 0, s2 = 0;
+        long diag1 = 0, diag2 = 0;
+        for (const GeneratedFile &f : files) {
+            string base = f.path.substr(0, f.path.size() - 4);
+            double s;
+            long rss;
+            if (!(ok = runTimed({bin + "/Pass1", "--quiet", f.path}, base + ".err1", s, rss, err))) break;
+            s1 += s;
+            p1.peakRssKb = max(p1.peakRssKb, rss);
+            diag1 += countLines(base + ".err1");
+            if (!(ok = runTimed({bin + "/Pass2", "--quiet", base + ".int"}, base + ".err2", s, rss, err))) break;
+            s2 += s;
+            p2.peakRssKb = max(p2.peakRssKb, rss);
+            diag2 += countLines(base + ".err2");
+            if (rep == 0) {
+                p1.bytes += fileSize(f.path);
+                p2.bytes += fileSize(base + ".int");
+            }
+        }
+        if (!ok) break;
+        if (rep == 0 || s1 < p1.seconds) p1.seconds = s1;
+        if (rep == 0 || s2 < p2.seconds) p2.seconds = s2;
+        if (rep == 0 || s1 + s2 < total.seconds) total.seconds = s1 + s2;
+        p1.diagnostics = diag1;
+        p2.diagnostics = diag2;
+    }
+    total.bytes = p1.bytes;
+    total.peakRssKb = max(p1.peakRssKb, p2.peakRssKb);
+    total.diagnostics = p1.diagnostics + p2.diagnostics;
+
+    if (!keep) {
+        for (const GeneratedFile &f : files) {
+            string base = f.path.substr(0, f.path.size() - 4);
+            for (const char *ext : {".asm", ".int", ".sym", ".txt", ".obj", ".err1", ".err2"})
+                unlink((base + ext).c_str());
+        }
+        rmdir(corpusDir.c_str());
+    }
+    if (!ok) return false;
+    results.push_back(p1);
+    results.push_back(p2);
+    results.push_back(total);
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION writeJson                                            ***
+*********************************************************************
+*** DESCRIPTION : Results as JSON, one result object per line so  ***
+***               a baseline can be read back line by line.       ***
+*** INPUT ARGS  : os, opts, repeat, results                       ***
+********************************************************************/
+static void writeJson(ostream &os, const GeneratorOptions &opts, int repeat,
+                      const vector<BenchResult> &results) {
+    os << fixed;
+    os << "{\n";
+    os << "  \"tool\": \"sicxebench\",\n";
+    os << "  \"generator\": {\"labels\": " << setprecision(3) << opts.labelDensity
+       << ", \"literals\": " << opts.literalDensity << ", \"ltorg\": " << opts.ltorgEvery
+       << ", \"format4\": " << opts.format4Ratio << ", \"equ_chain\": " << opts.equChain
+       << ", \"base\": " << opts.baseRatio << ", \"seed\": " << opts.seed << "},\n";
+    os << "  \"repeat\": " << repeat << ",\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        os << "    {\"name\": \"" << r.name << "\", \"phase\": \"" << r.phase
+           << "\", \"lines\": " << r.lines << ", \"files\": " << r.files
+           << ", \"bytes\": " << r.bytes
+           << ", \"seconds\": " << setprecision(6) << r.seconds
+           << ", \"lines_per_sec\": " << setprecision(1) << r.linesPerSec()
+           << ", \"mb_per_sec\": " << setprecision(3) << r.mbPerSec()
+           << ", \"peak_rss_kb\": " << r.peakRssKb
+           << ", \"diagnostics\": " << r.diagnostics << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+// Value of "key": <number> on a results line; false if absent
+static bool jsonNumber(const string &line, const string &key, double &value) {
+    size_t at = line.find("\"" + key + "\": ");
+    if (at == string::npos) return false;
+    value = strtod(line.c_str() + at + key.size() + 4, nullptr);
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION readBaseline                                         ***
+*********************************************************************
+*** DESCRIPTION : Reads lines_per_sec and peak_rss_kb per result  ***
+***               name from an earlier sicxebench JSON file.      ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : base - name -> {lines/sec, peak RSS KB}; err    ***
+*** RETURN      : bool - false if unreadable or has no results    ***
+********************************************************************/
+static bool readBaseline(const string &path, map<string, pair<double, double>> &base, string &err) {
+    ifstream in(path);
+    if (!in) { err = "cannot open baseline " + path; return false; }
+    string line;
+    while (getline(in, line)) {
+        size_t at = line.find("\"name\": \"");
+        if (at == string::npos) continue;
+        at += 9;
+        string name = line.substr(at, line.find('"', at) - at);
+        double lps = 0, rss = 0;
+        if (jsonNumber(line, "lines_per_sec", lps) && jsonNumber(line, "peak_rss_kb", rss))
+            base[name] = make_pair(lps, rss);
+    }
+    if (base.empty()) { err = "no results in baseline " + path; return false; }
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION compareBaseline                                      ***
+*********************************************************************
+*** DESCRIPTION : Prints each result against the baseline; a      ***
+***               throughput drop or RSS growth beyond tolerance  ***
+***               is flagged as a regression.                     ***
+*** INPUT ARGS  : results, base, tolerance (0.10 = 10%), os       ***
+*** RETURN      : int - number of regressions                     ***
+********************************************************************/
+static int compareBaseline(const vector<BenchResult> &results,
+                           const map<string, pair<double, double>> &base,
+                           double tolerance, ostream &os) {
+    int regressions = 0;
+    os << "\nCOMPARISON WITH BASELINE (tolerance " << fixed << setprecision(0)
+       << tolerance * 100 << "%)\n";
+    os << left << setw(16) << "BENCHMARK" << right << setw(14) << "BASE LINES/S"
+       << setw(14) << "LINES/S" << setw(9) << "CHANGE" << setw(12) << "BASE RSS KB"
+       << setw(10) << "RSS KB" << setw(9) << "CHANGE" << "  STATUS\n";
+    for (const BenchResult &r : results) {
+        auto it = base.find(r.name);
+        os << left << setw(16) << r.name << right;
+        if (it == base.end()) {
+            os << setw(14) << "-" << setprecision(0) << setw(14) << r.linesPerSec() << "  (new)\n";
+            continue;
+        }
+        double lps = it->second.first, rss = it->second.second;
+        double dl = lps > 0 ? (r.linesPerSec() - lps) / lps : 0;
+        double dr = rss > 0 ? (r.peakRssKb - rss) / rss : 0;
+        string status;
+        if (dl < -tolerance) status += " SLOWER";
+        if (dr > tolerance)  status += " MORE-RSS";
+        if (!status.empty()) ++regressions;
+        os << setprecision(0) << setw(14) << lps << setw(14) << r.linesPerSec()
+           << setprecision(1) << setw(8) << dl * 100 << "%"
+           << setprecision(0) << setw(12) << rss << setw(10) << r.peakRssKb
+           << setprecision(1) << setw(8) << dr * 100 << "%"
+           << "  " << (status.empty() ? "ok" : status.substr(1)) << "\n";
+    }
+    return regressions;
+}
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Throughput benchmark for Pass1/Pass2. For each  ***
+***               size, generates a corpus, times both passes as  ***
+***               separate processes, prints a table and writes   ***
+***               the JSON results; with --baseline, compares and ***
+***               fails on regressions.                           ***
+*** INPUT ARGS  : argc, argv - see usage                          ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 on success; 1 on errors; 2 if any       ***
+***               result regressed against the baseline           ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    const char *usage =
+        "Usage: sicxebench [--dir DIR] [--out FILE] [--baseline FILE] [--tolerance R]\n"
+        "                  [--repeat N] [--bin DIR] [--keep] [--labels R] [--literals R]\n"
+        "                  [--ltorg N] [--format4 R] [--equ-chain N] [--base R] [--seed S]\n"
+        "                  LINES...\n";
+    GeneratorOptions opts;
+    string dir = "bench", out, baseline, bin = ".";
+    double tolerance = 0.10;
+    int repeat = 1;
+    bool keep = false;
+    vector<long> sizes;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--keep") { keep = true; continue; }
+        if (arg.compare(0, 2, "--") != 0) {
+            long n = atol(arg.c_str());
+            if (n < 1) { cerr << usage; return 1; }
+            sizes.push_back(n);
+            continue;
+        }
+        if (i + 1 >= argc) { cerr << usage; return 1; }
+        const char *value = argv[++i];
+        if (arg == "--dir") dir = value;
+        else if (arg == "--out") out = value;
+        else if (arg == "--baseline") baseline = value;
+        else if (arg == "--tolerance") tolerance = atof(value);
+        else if (arg == "--repeat") repeat = atoi(value);
+        else if (arg == "--bin") bin = value;
+        else if (arg == "--labels") opts.labelDensity = atof(value);
+        else if (arg == "--literals") opts.literalDensity = atof(value);
+        else if (arg == "--ltorg") opts.ltorgEvery = atoi(value);
+        else if (arg == "--format4") opts.format4Ratio = atof(value);
+        else if (arg == "--equ-chain") opts.equChain = atoi(value);
+        else if (arg == "--base") opts.baseRatio = atof(value);
+        else if (arg == "--seed") opts.seed = strtoull(value, nullptr, 10);
+        else { cerr << usage; return 1; }
+    }
+    if (sizes.empty() || repeat < 1) { cerr << usage; return 1; }
+    if (out.empty()) out = dir + "/results.json";
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        cerr << "Error: cannot create " << dir << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    // Read the baseline first so a bad path fails before the long run
+    map<string, pair<double, double>> base;
+    string err;
+    if (!baseline.empty() && !readBaseline(baseline, base, err)) { cerr << "Error: " << err << endl; return 1; }
+
+    cout << left << setw(16) << "BENCHMARK" << right << setw(10) << "LINES" << setw(7) << "FILES"
+         << setw(11) << "SECONDS" << setw(13) << "LINES/S" << setw(9) << "MB/S"
+         << setw(13) << "PEAK RSS KB" << setw(7) << "DIAG" << "\n";
+    vector<BenchResult> results;
+    for (long lines : sizes) {
+        size_t first = results.size();
+        if (!benchCorpus(opts, lines, bin, dir, repeat, keep, results, err)) {
+            cerr << "Error: " << err << endl;
+            return 1;
+        }
+        for (size_t i = first; i < results.size(); ++i) {
+            const BenchResult &r = results[i];
+            cout << left << setw(16) << r.name << right << setw(10) << r.lines << setw(7) << r.files
+                 << fixed << setprecision(3) << setw(11) << r.seconds
+                 << setprecision(0) << setw(13) << r.linesPerSec()
+                 << setprecision(2) << setw(9) << r.mbPerSec()
+                 << setw(13) << r.peakRssKb << setw(7) << r.diagnostics << "\n" << flush;
+        }
+    }
+
+    ofstream json(out);
+    writeJson(json, opts, repeat, results);
+    json.close();
+    if (!json) { cerr << "Error: write failed for " << out << endl; return 1; }
+    cout << "\nResults written to: " << out << "\n";
+
+    if (base.empty()) return 0;
+    int regressions = compareBaseline(results, base, tolerance, cout);
+    if (regressions > 0) {
+        cout << regressions << " regression(s) beyond " << setprecision(0) << tolerance * 100 << "%\n";
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Batch.h"
+#include "Daemon.h"
+
+using namespace std;
+
+// Absolute form of path (the daemon has its own working directory)
+static string absolutePath(const string &path) {
+    if (!path.empty() && path[0] == '/') return path;
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return path;
+    return string(cwd) + "/" + path;
+}
+
+static int connectTo(const string &path, string &err) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) { err = "socket path too long: " + path; return -1; }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        err = "cannot reach sicxed on " + path + ": " + strerror(errno) + " (start it with ./sicxed)";
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Thin client for sicxed. Sends each source (by   ***
+***               path, or its text with --inline) over one       ***
+***               connection and prints the daemon's diagnostics  ***
+***               on stderr and one status line per source.       ***
+***               `sicxec x.asm` writes the same x.int, x.sym,    ***
+***               x.txt and x.obj as ./Pass1 x.asm && ./Pass2     ***
+***               x.int. --stats prints the daemon's request      ***
+***               latency percentiles; --shutdown stops it.       ***
+*** INPUT ARGS  : argc, argv - sicxec [--socket PATH]             ***
+***                 [--outputs all|int,sym,txt,obj] [--inline]    ***
+***                 [--quiet] <source.asm>...                     ***
+***               sicxec [--socket PATH] --stats | --shutdown     ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 if every source was assembled (possibly ***
+***               with diagnostics); 1 otherwise                  ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    string socketPath = defaultDaemonSocket();
+    unsigned artifacts = ARTIFACT_ALL;
+    bool sendText = false, quiet = false, stats = false, shutdownDaemon = false;
+    vector<string> sources;
+    const char *usage = "Usage: sicxec [--socket PATH] [--outputs all|int,sym,txt,obj]"
+                        " [--inline] [--quiet] <source.asm>...\n"
+                        "       sicxec [--socket PATH] --stats | --shutdown\n";
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) socketPath = argv[++i];
+        else if (arg == "--inline") sendText = true;
+        else if (arg == "--quiet") quiet = true;
+        else if (arg == "--stats") stats = true;
+        else if (arg == "--shutdown") shutdownDaemon = true;
+        else if (arg == "--outputs" && i + 1 < argc) {
+            if (!parseArtifactList(argv[++i], artifacts)) { cerr << usage; return 1; }
+        }
+        else sources.push_back(arg);
+    }
+    if (sources.empty() == !(stats || shutdownDaemon) || (stats && shutdownDaemon)) {
+        cerr << usage;
+        return 1;
+    }
+
+    string err;
+    int fd = connectTo(socketPath, err);
+    if (fd < 0) {
+        cerr << "Error: " << err << endl;
+        return 1;
+    }
+    DaemonStream stream(fd);
+    DaemonResponse resp;
+
+    if (stats || shutdownDaemon) {
+        DaemonRequest req;
+        req.kind = stats ? DaemonRequest::STATS : DaemonRequest::SHUTDOWN;
+        bool ok = stream.writeRequest(req, err) && stream.readResponse(resp, err);
+        ::close(fd);
+        if (!ok) { cerr << "Error: " << err << endl; return 1; }
+        cout << resp.report;
+        return 0;
+    }
+
+    int failed = 0;
+    for (const auto &source : sources) {
+        DaemonRequest req;
+        req.path = absolutePath(source);
+        req.artifacts = artifacts;
+        if (sendText) {
+            ifstream in(source, ios::binary);
+            if (!in) { cerr << "Error: Cannot open file " << source << endl; ++failed; continue; }
+            ostringstream text;
+            text << in.rdbuf();
+            req.hasText = true;
+            req.text = text.str();
+        }
+        if (!stream.writeRequest(req, err) || !stream.readResponse(resp, err)) {
+            cerr << "Error: " << err << endl;
+            ::close(fd);
+            return 1;
+        }
+        cerr << resp.diagnostics;
+        if (resp.status == "failed") ++failed;
+        if (!quiet) {
+            cout << source << ": " << resp.status << " in " << fixed << setprecision(2)
+                 << resp.ms << " ms";
+            for (const auto &path : resp.artifacts) cout << " " << path;
+            cout << "\n";
+        }
+    }
+    ::close(fd);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "OpcodeTable.h"
+#include "Batch.h"
+#include "Daemon.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static volatile sig_atomic_t stopSignal = 0;
+static void onStopSignal(int) { stopSignal = 1; }
+
+// State shared by the accept loop, the connection threads and the pool
+struct Daemon {
+    const OpcodeTable &optab;
+    ThreadPool &pool;
+    LatencyLog latency;
+    int listenFd = -1;
+    atomic<bool> stopping{false};
+    bool quiet = false;
+    mutex connLock;                     // guards openFds
+    condition_variable connClosed;
+    set<int> openFds;                   // connections whose thread still runs
+
+    Daemon(const OpcodeTable &optab, ThreadPool &pool) : optab(optab), pool(pool) {}
+};
+
+static bool socketAddress(const string &path, sockaddr_un &addr, string &err) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) { err = "socket path too long: " + path; return false; }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+/********************************************************************
+*** FUNCTION listenOn                                             ***
+*********************************************************************
+*** DESCRIPTION : Binds and listens on the socket path. A stale   ***
+***               socket file (no daemon answering) is replaced;  ***
+***               a live one is an error.                         ***
+*** INPUT ARGS  : path                                            ***
+*** OUTPUT ARGS : err                                             ***
+*** RETURN      : int - listening descriptor, -1 on failure       ***
+********************************************************************/
+static int listenOn(const string &path, string &err) {
+    sockaddr_un addr;
+    if (!socketAddress(path, addr, err)) return -1;
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        bool live = connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+        ::close(probe);
+        if (live) { err = "a daemon is already listening on " + path; return -1; }
+    }
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        err = "cannot listen on " + path + ": " + strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/********************************************************************
+*** FUNCTION assembleOnPool                                       ***
+*********************************************************************
+*** DESCRIPTION : Runs one ASSEMBLE request as a pool task, with  ***
+***               the shared, already built OpcodeTable, and      ***
+***               waits for it. Only requests occupy workers, so  ***
+***               idle connections never hold one.                ***
+*** INPUT ARGS  : req - the request                               ***
+*** IN/OUT ARGS : d   - daemon state                              ***
+*** RETURN      : DaemonResponse - status, diagnostics, artifacts ***
+********************************************************************/
+static DaemonResponse assembleOnPool(const DaemonRequest &req, Daemon &d) {
+    DaemonResponse resp;
+    promise<void> done;
+    d.pool.submit([&] {
+        try {
+            BatchFileResult result;
+            assembleFile(req.path, d.optab, "file", result, nullptr,
+                         req.hasText ? &req.text : nullptr, req.artifacts);
+            resp.status = result.failed ? "failed" : result.hasErrors ? "errors" : "ok";
+            resp.ms = result.totalMs;
+            resp.diagnostics = result.diagnostics;
+            if (result.failed) resp.diagnostics += "Error: " + result.failure + "\n";
+            resp.artifacts = std::move(result.artifacts);
+        } catch (const exception &e) {
+            resp.status = "failed";
+            resp.diagnostics = string("Error: ") + e.what() + "\n";
+        }
+        done.set_value();
+    });
+    done.get_future().wait();
+    return resp;
+}
+
+/********************************************************************
+*** FUNCTION serveConnection                                      ***
+*********************************************************************
+*** DESCRIPTION : Reads and answers requests on one connection    ***
+***               until the client closes it or the daemon shuts  ***
+***               it down. Runs on its own thread, which blocks   ***
+***               on the socket; assembly is handed to the pool   ***
+***               one request at a time. Each request's latency   ***
+***               (request read to response written) goes to the  ***
+***               log. A SHUTDOWN is answered before the daemon   ***
+***               stops.                                          ***
+*** INPUT ARGS  : fd - accepted connection (closed on return)     ***
+*** IN/OUT ARGS : d  - daemon state                               ***
+********************************************************************/
+static void serveConnection(int fd, Daemon &d) {
+    DaemonStream stream(fd);
+    DaemonRequest req;
+    string err;
+    while (stream.readRequest(req, err)) {
+        Clock::time_point t0 = Clock::now();
+        DaemonResponse resp;
+        resp.status = "ok";
+        if (req.kind == DaemonRequest::STATS) {
+            ostringstream os;
+            d.latency.report(os);
+            resp.report = os.str();
+        }
+        else if (req.kind == DaemonRequest::ASSEMBLE) {
+            resp = assembleOnPool(req, d);
+        }
+        if (!stream.writeResponse(resp, err)) break;
+        if (req.kind == DaemonRequest::ASSEMBLE)
+            d.latency.record(chrono::duration<double, milli>(Clock::now() - t0).count());
+        if (req.kind == DaemonRequest::SHUTDOWN) {
+            d.stopping = true;
+            ::shutdown(d.listenFd, SHUT_RDWR);      // wakes the accept loop
+        }
+    }
+    if (!err.empty() && !d.quiet) cerr << "sicxed: " << err << endl;
+    lock_guard<mutex> g(d.connLock);
+    ::close(fd);
+    d.openFds.erase(fd);
+    d.connClosed.notify_all();
+}
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Resident SIC/XE assembler. Builds the opcode    ***
+***               table and a worker pool once, then serves       ***
+***               assemble requests from sicxec over a Unix       ***
+***               socket (protocol in Daemon.h). Each connection  ***
+***               is read on its own thread and each request is a ***
+***               pool task. Stops on SIGINT/SIGTERM or a         ***
+***               SHUTDOWN request: open connections are shut     ***
+***               down, running requests finish, and the request  ***
+***               latency percentiles are printed.                ***
+*** INPUT ARGS  : argc, argv - sicxed [--socket PATH] [--jobs N]  ***
+***                            [--quiet]                          ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 on a clean stop; 1 if it cannot listen  ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    string socketPath = defaultDaemonSocket();
+    int jobs = 0;
+    bool quiet = false;
+    const char *usage = "Usage: sicxed [--socket PATH] [--jobs N] [--quiet]\n";
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) socketPath = argv[++i];
+        else if (arg == "--quiet") quiet = true;
+        else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs < 1) { cerr << usage; return 1; }
+        }
+        else { cerr << usage; return 1; }
+    }
+    if (jobs == 0) jobs = max(1u, thread::hardware_concurrency());
+
+    string err;
+    int listenFd = listenOn(socketPath, err);
+    if (listenFd < 0) {
+        cerr << "Error: " << err << endl;
+        return 1;
+    }
+
+    // Only this thread takes SIGINT/SIGTERM (workers and connection
+    // threads start with them blocked), so they interrupt accept() below
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t stopSet, oldSet;
+    sigemptyset(&stopSet);
+    sigaddset(&stopSet, SIGINT);
+    sigaddset(&stopSet, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSet, &oldSet);
+    ThreadPool pool(jobs);
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+    OpcodeTable optab;
+    Daemon d(optab, pool);
+    d.quiet = quiet;
+    d.listenFd = listenFd;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;           // no SA_RESTART: accept() returns EINTR
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    if (!quiet)
+        cout << "sicxed: listening on " << socketPath << " (" << jobs << " workers)" << endl;
+    while (!stopSignal && !d.stopping) {
+        int fd = accept4(d.listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (!d.stopping) cerr << "sicxed: accept: " << strerror(errno) << endl;
+            break;
+        }
+        {
+            lock_guard<mutex> g(d.connLock);
+            d.openFds.insert(fd);
+        }
+        pthread_sigmask(SIG_BLOCK, &stopSet, &oldSet);
+        thread(serveConnection, fd, ref(d)).detach();
+        pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+    }
+    ::close(d.listenFd);
+    unlink(socketPath.c_str());
+
+    // Idle clients would keep their threads reading forever: end every
+    // open connection, let requests already running finish, then wait
+    {
+        unique_lock<mutex> g(d.connLock);
+        for (int fd : d.openFds) ::shutdown(fd, SHUT_RDWR);
+        d.connClosed.wait(g, [&d] { return d.openFds.empty(); });
+    }
+    pool.wait();
+
+    if (!quiet) {
+        cout << "sicxed: stopped. ";
+        d.latency.report(cout);
+    }
+    return 0;
+}
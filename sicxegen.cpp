@@ -0,0 +1,54 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SourceGenerator.h"
+
+using namespace std;
+
+/********************************************************************
+*** FUNCTION main                                                 ***
+*********************************************************************
+*** DESCRIPTION : Synthetic source generator. Writes one program  ***
+***               to stdout, or with -o PREFIX as many programs   ***
+***               (PREFIX.asm, PREFIX-1.asm, ...) as the line     ***
+***               count needs, listing them on stdout.            ***
+*** INPUT ARGS  : argc, argv - see usage; ratios are 0..1         ***
+*** OUTPUT ARGS : none                                            ***
+*** IN/OUT ARGS : none                                            ***
+*** RETURN      : int - 0 on success; non-zero on errors          ***
+********************************************************************/
+int main(int argc, char* argv[]) {
+    const char *usage =
+        "Usage: sicxegen [--lines N] [--labels R] [--literals R] [--ltorg N]\n"
+        "                [--format4 R] [--equ-chain N] [--base R] [--seed S] [-o PREFIX]\n";
+    GeneratorOptions opts;
+    string prefix;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) { cerr << usage; return 1; }
+        const char *value = argv[++i];
+        if (arg == "--lines") opts.lines = atol(value);
+        else if (arg == "--labels") opts.labelDensity = atof(value);
+        else if (arg == "--literals") opts.literalDensity = atof(value);
+        else if (arg == "--ltorg") opts.ltorgEvery = atoi(value);
+        else if (arg == "--format4") opts.format4Ratio = atof(value);
+        else if (arg == "--equ-chain") opts.equChain = atoi(value);
+        else if (arg == "--base") opts.baseRatio = atof(value);
+        else if (arg == "--seed") opts.seed = strtoull(value, nullptr, 10);
+        else if (arg == "-o") prefix = value;
+        else { cerr << usage; return 1; }
+    }
+    if (opts.lines < 1 || opts.ltorgEvery < 0 || opts.equChain < 0) { cerr << usage; return 1; }
+
+    SourceGenerator gen(opts);
+    string err;
+    if (prefix.empty()) {
+        if (!gen.writeStream(cout, err)) { cerr << "Error: " << err << endl; return 1; }
+        return 0;
+    }
+    vector<GeneratedFile> files;
+    if (!gen.writeFiles(prefix, files, err)) { cerr << "Error: " << err << endl; return 1; }
+    for (const GeneratedFile &f : files) cout << f.path << " " << f.lines << "\n";
+    return 0;
+}
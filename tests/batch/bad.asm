@@ -0,0 +1,4 @@
+BAD:     START   0
+FIRST:   LDA     BUF
+BUF:     RESW    ABC
+         END     FIRST
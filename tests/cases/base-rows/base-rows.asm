@@ -0,0 +1,9 @@
+BASER:   START   0
+         BASE    TABLE
+FIRST:   LDA     TABLE
+         NOBASE
+         STA     TABLE
+         J       FIRST
+BUF:     RESB    4096
+TABLE:   WORD    5
+         END     FIRST
@@ -0,0 +1,9 @@
+PROGA:   START   0
+         EXTDEF  ABSV
+FIRST:   LDA     =C'XY'
+         +LDB    #ABSV
+ABSV:    EQU     4096
+PROGB:   CSECT
+         LDA     #5
+         RSUB
+         END     FIRST
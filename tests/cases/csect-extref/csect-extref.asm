@@ -0,0 +1,14 @@
+PROGA:   START   0
+         EXTDEF  LISTA,ENDA
+         EXTREF  LISTB
+REF1:    LDA     LISTA
+REF2:    +LDT    LISTB
+LISTA:   WORD    5
+ENDA:    EQU     *
+PROGB:   CSECT
+         EXTDEF  LISTB
+         EXTREF  LISTA,ENDA
+LISTB:   WORD    3
+REF3:    +STA    LISTA
+         RMO     A,X
+         END     REF1
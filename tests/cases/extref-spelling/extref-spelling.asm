@@ -0,0 +1,5 @@
+PROGA    START   0
+         EXTREF  LISTBUFFER
+         +LDA    listbuffer
+         WORD    ListBuffer
+         END     PROGA
@@ -0,0 +1,9 @@
+POOLS:   START   0
+FIRST:   LDA     =C'AB'
+         LDX     =X'0F'
+         LTORG
+         LDA     =C'CD'
+         LTORG
+         LDB     =X'0F'
+         RSUB
+         END     FIRST
@@ -0,0 +1,7 @@
+LTROW:   START   0
+FIRST:   LDA     ALPHA
+         LTORG
+         LDA     =C'AB'
+         RSUB
+ALPHA:   WORD    7
+         END     FIRST
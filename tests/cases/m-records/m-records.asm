@@ -0,0 +1,24 @@
+PROGM    START   0
+         EXTREF  SUBR
+ABSEQU   EQU     4096
+FIRST    +JSUB   SUBR
+         +JSUB   LOOP
+         +LDA    #TABLE
+         +STA    BUF,X
+         +LDA    =X'0000F1'
+         +LDA    #4096
+         +LDA    ABSEQU
+LOOP     LDA     BUF
+         BASE    TABLE
+         +LDB    #TABLE
+         STA     TABLE
+         J       LOOP
+PTR      WORD    TABLE
+         WORD    SUBR
+         WORD    12
+         WORD    ABSEQU
+BUF      RESW    1
+         LTORG
+GAP      RESB    4096
+TABLE    RESB    16
+         END     FIRST
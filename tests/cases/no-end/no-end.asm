@@ -0,0 +1,5 @@
+NOEND:   START   0
+FIRST:   LDA     =C'AB'
+         STA     BUF
+         RSUB
+BUF:     RESW    1
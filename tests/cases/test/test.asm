@@ -0,0 +1,11 @@
+PROG:    START   0
+FIRST:   STL     RETADR
+SECOND:  LDA     =C'ABCD'
+THIRD:   LDA     =X'FF'
+         J       @RETADR
+DEF:     BYTE    C'DEF'
+SYM1:    EQU     512
+SYM2:    EQU     *
+SYM3:    EQU     SECOND-FIRST
+RETADR:  RESW    1
+         END     FIRST
\ No newline at end of file
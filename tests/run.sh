@@ -0,0 +1,171 @@
+#!/bin/sh
+# Golden-output checks for the assembler.
+#
+# Each directory under tests/cases holds one source, <name>.asm, and the
+# <name>.int, <name>.txt and <name>.obj that Pass1 and Pass2 must write
+# for it. <name>.err, if present, holds the diagnostics both passes print
+# on stderr; without it they must print none. A before/ subdirectory,
+# where present, keeps the output of the revision before the change the
+# case was added for; it is documentation and is not checked.
+#
+# The mode checks after that run other drivers and modes on copies of
+# those cases and expect the same goldens; their own fixtures live in
+# tests/<mode>.
+#
+# Run from anywhere after building: sh tests/run.sh
+
+cd "$(dirname "$0")/.." || exit 1
+ROOT=$(pwd)
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+passed=0
+
+# same NAME EXPECTED ACTUAL: compare one output file with its golden copy
+same() {
+    if cmp -s "$2" "$3"; then
+        return 0
+    fi
+    echo "FAIL $1: $(basename "$2") differs"
+    diff "$2" "$3" | head -20
+    return 1
+}
+
+# tally OK: count one check as passed (OK=1) or failed
+tally() {
+    if [ "$1" = 1 ]; then
+        passed=$((passed + 1))
+    else
+        failed=$((failed + 1))
+    fi
+}
+
+for dir in tests/cases/*/; do
+    name=$(basename "$dir")
+    out="$WORK/$name"
+    mkdir -p "$out"
+    cp "$dir$name.asm" "$out/"
+    ./Pass1 "$out/$name.asm" --quiet > /dev/null 2> "$out/$name.err"
+    ./Pass2 "$out/$name.int" --quiet > /dev/null 2>> "$out/$name.err"
+    ok=1
+    for ext in int txt obj; do
+        same "$name" "$dir$name.$ext" "$out/$name.$ext" || ok=0
+    done
+    err="$dir$name.err"
+    [ -f "$err" ] || err=/dev/null
+    same "$name" "$err" "$out/$name.err" || ok=0
+    tally $ok
+done
+
+# Every case, and the ones without control sections
+CASES=$(ls tests/cases)
+PLAIN=$(for c in $CASES; do grep -qi csect "tests/cases/$c/$c.asm" || echo "$c"; done)
+
+# mode LABEL EXTS RUN CASE...: for each case, copy its source to a scratch
+# directory, run the shell command RUN there with $N set to the case name,
+# then compare the outputs with extensions EXTS, and stderr, with the
+# case's goldens
+mode() {
+    label=$1
+    exts=$2
+    run=$3
+    shift 3
+    for name in "$@"; do
+        dir="tests/cases/$name"
+        out="$WORK/$label/$name"
+        mkdir -p "$out"
+        cp "$dir/$name.asm" "$out/"
+        (cd "$out" && N=$name && eval "$run") > /dev/null 2> "$out/$name.err"
+        ok=1
+        for ext in $exts; do
+            same "$label $name" "$dir/$name.$ext" "$out/$name.$ext" || ok=0
+        done
+        err="$dir/$name.err"
+        [ -f "$err" ] || err=/dev/null
+        same "$label $name" "$err" "$out/$name.err" || ok=0
+        tally $ok
+    done
+}
+
+# Binary intermediate: Pass 2 reads the .intb, intb2int turns it back into
+# the text .int
+mode intb "int txt obj" \
+    '"$ROOT/Pass1" $N.asm --intb --quiet; "$ROOT/Pass2" $N.intb --quiet; "$ROOT/intb2int" $N.intb' \
+    $CASES
+
+# --jobs: split passes and the fused driver on 4 threads
+mode jobs "int txt obj" \
+    '"$ROOT/Pass1" $N.asm --jobs 4 --quiet; "$ROOT/Pass2" $N.int --jobs 4 --quiet' \
+    $CASES
+mode sicxe-jobs "int txt obj" '"$ROOT/sicxe" $N.asm --int --jobs 4 --quiet' $CASES
+
+# Streaming Pass 2 (it does not take control sections)
+mode stream "txt obj" '"$ROOT/Pass1" $N.asm --quiet; "$ROOT/Pass2" $N.int --stream --quiet' $PLAIN
+
+# --incremental: the first run fills <name>.objcache, the second must
+# give the same outputs from it
+mode incremental "int txt obj" \
+    '"$ROOT/Pass1" $N.asm --quiet; for i in 1 2; do "$ROOT/Pass2" $N.int --incremental --quiet 2> $N.err2; done; cat $N.err2 >&2' \
+    $CASES
+mode sicxe-incremental "txt obj" \
+    'for i in 1 2; do "$ROOT/sicxe" $N.asm --incremental --quiet 2> $N.err2; done; cat $N.err2 >&2' \
+    $CASES
+
+# Filter mode: source on stdin, object program on stdout, listing on
+# descriptor 3
+mode filter "txt obj" '"$ROOT/sicxe" - --listing-fd 3 < $N.asm > $N.obj 3> $N.txt' $CASES
+
+# The cases are too small to be split into chunks; a generated program
+# big enough for both passes to split it must come out the same as on
+# one thread
+out="$WORK/jobs-gen"
+mkdir -p "$out/1" "$out/4"
+./sicxegen --lines 12000 --seed 7 > "$out/1/gen.asm"
+cp "$out/1/gen.asm" "$out/4/"
+for j in 1 4; do
+    (cd "$out/$j" && "$ROOT/Pass1" gen.asm --jobs $j --quiet && "$ROOT/Pass2" gen.int --jobs $j --quiet) \
+        > /dev/null 2>&1
+done
+ok=1
+for ext in int sym txt obj; do
+    same "jobs generated" "$out/1/gen.$ext" "$out/4/gen.$ext" || ok=0
+done
+tally $ok
+
+# Batch: a source whose assembly aborts is reported as failed and the
+# others are still assembled
+out="$WORK/batch"
+mkdir -p "$out"
+cp tests/cases/test/test.asm tests/batch/bad.asm "$out/"
+ok=1
+if (cd "$out" && "$ROOT/sicxe" --batch --jobs 2 test.asm bad.asm > /dev/null 2> batch.err); then
+    echo "FAIL batch: exit status 0 with a failed source"
+    ok=0
+fi
+same batch tests/batch/batch.err "$out/batch.err" || ok=0
+for ext in int txt obj; do
+    same batch "tests/cases/test/test.$ext" "$out/test.$ext" || ok=0
+done
+tally $ok
+
+# Daemon: one sicxed serves every case through sicxec, then shuts down
+SOCK="$WORK/sicxed.sock"
+./sicxed --socket "$SOCK" --jobs 2 --quiet &
+daemon=$!
+trap 'kill $daemon 2> /dev/null; rm -rf "$WORK"' EXIT
+i=0
+while [ ! -S "$SOCK" ] && [ $i -lt 50 ]; do
+    sleep 0.1
+    i=$((i + 1))
+done
+mode daemon "int txt obj" '"$ROOT/sicxec" --socket "$SOCK" $N.asm' $CASES
+ok=1
+if ! ./sicxec --socket "$SOCK" --shutdown > /dev/null || ! wait $daemon; then
+    echo "FAIL daemon: shutdown"
+    ok=0
+fi
+tally $ok
+
+echo "$passed passed, $failed failed"
+[ $failed = 0 ]